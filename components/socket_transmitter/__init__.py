@@ -9,34 +9,131 @@ MULTI_CONF = True
 
 CODEOWNERS = ["@SzczepanLeon", "@kubasaw"]
 
+CONF_PERSISTENT = "persistent"
+CONF_TCP_NODELAY = "tcp_nodelay"
+CONF_KEEPALIVE = "keepalive"
+CONF_QUEUE_SIZE = "queue_size"
+CONF_RECONNECT_MIN_INTERVAL = "reconnect_min_interval"
+CONF_RECONNECT_MAX_INTERVAL = "reconnect_max_interval"
+CONF_FRAMING = "framing"
+CONF_BATCH = "batch"
+CONF_MAX_FRAMES = "max_frames"
+CONF_MAX_BYTES = "max_bytes"
+CONF_MAX_DELAY = "max_delay"
+
+# Ethernet MTU minus IPv4 and UDP headers, larger datagrams get fragmented
+UDP_MAX_PAYLOAD = 1500 - 20 - 8
+
 
 socket_ns = cg.esphome_ns.namespace("socket_transmitter")
 SocketTransmitter = socket_ns.class_("SocketTransmitter", cg.Component)
 SocketTransmitterSendAction = socket_ns.class_(
     "SocketTransmitterSendAction", automation.Action
 )
+SocketTransmitterWriteAction = socket_ns.class_(
+    "SocketTransmitterWriteAction", automation.Action
+)
+Framing = socket_ns.enum("Framing", is_class=True)
 
-CONFIG_SCHEMA = cv.Schema(
+FRAMING_OPTIONS = {
+    "NONE": Framing.NONE,
+    "LENGTH_PREFIXED": Framing.LENGTH_PREFIXED,
+}
+
+BATCH_SCHEMA = cv.Schema(
     {
-        cv.GenerateID(): cv.declare_id(SocketTransmitter),
-        cv.Required(CONF_IP_ADDRESS): cv.All(cv.ipv4address, cv.string),
-        cv.Required(CONF_PORT): cv.port,
-        cv.Required(CONF_PROTOCOL): cv.enum(
-            {
-                "TCP": cg.RawExpression("SOCK_STREAM"),
-                "UDP": cg.RawExpression("SOCK_DGRAM"),
-            },
-            upper=True,
+        cv.Optional(CONF_MAX_FRAMES, default=10): cv.int_range(min=1, max=255),
+        cv.Optional(CONF_MAX_BYTES, default=1400): cv.int_range(
+            min=64, max=16384
         ),
+        cv.Optional(
+            CONF_MAX_DELAY, default="1s"
+        ): cv.positive_time_period_milliseconds,
     }
 )
 
 
+def _validate_batch(config):
+    batch = config.get(CONF_BATCH)
+    # Without a length prefix the receiver cannot split a batch into frames
+    if batch is not None and config[CONF_FRAMING] != "LENGTH_PREFIXED":
+        raise cv.Invalid(
+            f"{CONF_BATCH} requires {CONF_FRAMING}: LENGTH_PREFIXED",
+            path=[CONF_FRAMING],
+        )
+    if (
+        batch is not None
+        and config[CONF_PROTOCOL] == "UDP"
+        and batch[CONF_MAX_BYTES] > UDP_MAX_PAYLOAD
+    ):
+        raise cv.Invalid(
+            f"UDP batches are sent as one datagram, {CONF_MAX_BYTES} must be at most {UDP_MAX_PAYLOAD}",
+            path=[CONF_BATCH, CONF_MAX_BYTES],
+        )
+    return config
+
+
+CONFIG_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.declare_id(SocketTransmitter),
+            cv.Required(CONF_IP_ADDRESS): cv.All(cv.ipv4address, cv.string),
+            cv.Required(CONF_PORT): cv.port,
+            cv.Required(CONF_PROTOCOL): cv.enum(
+                {
+                    "TCP": cg.RawExpression("SOCK_STREAM"),
+                    "UDP": cg.RawExpression("SOCK_DGRAM"),
+                },
+                upper=True,
+            ),
+            # Keep the connection open and send from a queue in the main loop
+            cv.Optional(CONF_PERSISTENT, default=False): cv.boolean,
+            cv.Optional(CONF_TCP_NODELAY, default=True): cv.boolean,
+            cv.Optional(CONF_KEEPALIVE, default=True): cv.boolean,
+            # Frames waiting for the connection, newer ones are dropped when full
+            cv.Optional(CONF_QUEUE_SIZE, default=16): cv.int_range(min=1, max=256),
+            cv.Optional(
+                CONF_RECONNECT_MIN_INTERVAL, default="1s"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(
+                CONF_RECONNECT_MAX_INTERVAL, default="60s"
+            ): cv.positive_time_period_milliseconds,
+            # Prefix every frame with its length (2 bytes, big endian)
+            cv.Optional(CONF_FRAMING, default="NONE"): cv.enum(
+                FRAMING_OPTIONS, upper=True
+            ),
+            # Collect frames and send them together
+            cv.Optional(CONF_BATCH): BATCH_SCHEMA,
+        }
+    ),
+    _validate_batch,
+)
+
+
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
     cg.add(var.set_host(config[CONF_IP_ADDRESS]))
     cg.add(var.set_port(config[CONF_PORT]))
     cg.add(var.set_protocol(config[CONF_PROTOCOL]))
+    cg.add(var.set_persistent(config[CONF_PERSISTENT]))
+    cg.add(var.set_tcp_nodelay(config[CONF_TCP_NODELAY]))
+    cg.add(var.set_keepalive(config[CONF_KEEPALIVE]))
+    cg.add(var.set_queue_size(config[CONF_QUEUE_SIZE]))
+    cg.add(
+        var.set_reconnect_interval(
+            config[CONF_RECONNECT_MIN_INTERVAL].total_milliseconds,
+            config[CONF_RECONNECT_MAX_INTERVAL].total_milliseconds,
+        )
+    )
+    cg.add(var.set_framing(config[CONF_FRAMING]))
+    if batch := config.get(CONF_BATCH):
+        cg.add(
+            var.set_batch(
+                batch[CONF_MAX_FRAMES],
+                batch[CONF_MAX_BYTES],
+                batch[CONF_MAX_DELAY].total_milliseconds,
+            )
+        )
 
     await cg.register_component(var, config)
 
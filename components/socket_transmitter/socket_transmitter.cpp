@@ -1,20 +1,110 @@
 #include "socket_transmitter.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/select.h>
+
+#include "esphome/core/hal.h"
+
 namespace esphome {
 namespace socket_transmitter {
-void SocketTransmitter::send(std::string data) {
-  return this->send((uint8_t *)data.c_str(), data.length());
+static const uint32_t CONNECT_TIMEOUT_MS = 10000;
+
+static bool would_block(int err) {
+  return err == EAGAIN || err == EWOULDBLOCK || err == EINPROGRESS ||
+         err == EALREADY || err == ENOTCONN;
+}
+
+void SocketTransmitter::setup() {
+  // The queue slots keep their capacity, after the first frames no
+  // allocation happens while forwarding.
+  if (this->persistent_)
+    this->queue_.resize(this->queue_size_);
 }
 
-void SocketTransmitter::send(std::vector<uint8_t> data) {
+void SocketTransmitter::send(std::string_view data) {
+  return this->send((const uint8_t *)data.data(), data.size());
+}
+
+void SocketTransmitter::send(const std::vector<uint8_t> &data) {
   return this->send(data.data(), data.size());
 }
 
 void SocketTransmitter::send(const uint8_t *data, size_t length) {
+  if (this->framing_ == Framing::NONE && this->batch_max_records_ <= 1) {
+    this->deliver_(data, length);
+    return;
+  }
+  this->add_record_(data, length);
+}
+
+void SocketTransmitter::add_record_(const uint8_t *data, size_t length) {
+  size_t prefix_size = 0;
+  if (this->framing_ == Framing::LENGTH_PREFIXED) {
+    if (length > 0xFFFF) {
+      ESP_LOGE(TAG, "Frame too long for length prefix [%d bytes]", length);
+      return;
+    }
+    prefix_size = 2;
+  }
+
+  // Records are never split, a payload that would outgrow the size limit
+  // (the datagram size for UDP) is sent first.
+  if (!this->batch_.empty() &&
+      this->batch_.size() + prefix_size + length > this->batch_max_bytes_)
+    this->flush_batch_();
+
+  if (this->batch_.empty())
+    this->batch_started_ = millis();
+  if (prefix_size) {
+    this->batch_.push_back(length >> 8);
+    this->batch_.push_back(length & 0xFF);
+  }
+  this->batch_.insert(this->batch_.end(), data, data + length);
+  this->batch_records_++;
+
+  if (this->batch_records_ >= this->batch_max_records_ ||
+      this->batch_.size() >= this->batch_max_bytes_)
+    this->flush_batch_();
+}
+
+void SocketTransmitter::flush_batch_() {
+  if (this->batch_.empty())
+    return;
+  ESP_LOGV(TAG, "Flushing %u frames [%u bytes]", this->batch_records_,
+           this->batch_.size());
+  this->deliver_(this->batch_.data(), this->batch_.size());
+  this->batch_.clear();
+  this->batch_records_ = 0;
+}
+
+void SocketTransmitter::deliver_(const uint8_t *data, size_t length) {
+  if (!this->persistent_) {
+    this->send_once_(data, length);
+    return;
+  }
+
+  if (this->queue_count_ >= this->queue_.size()) {
+    this->dropped_++;
+    ESP_LOGW(TAG, "Send queue full, dropping frame [%d bytes] (%u dropped)",
+             length, this->dropped_);
+    return;
+  }
+  size_t tail = (this->queue_head_ + this->queue_count_) % this->queue_.size();
+  this->queue_[tail].assign(data, data + length);
+  this->queue_count_++;
+  if (this->state_ == State::CONNECTED)
+    this->flush_();
+}
+
+void SocketTransmitter::send_once_(const uint8_t *data, size_t length) {
   ESP_LOGD(TAG, "Setting up socket transmitter");
-  this->socket_ = socket::socket_ip(this->protocol, 0);
-  int enable = 1;
-  this->socket_->setsockopt(SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  this->socket_ = this->open_socket_();
+  if (!this->socket_) {
+    ESP_LOGE(TAG, "Failed to create socket");
+    return;
+  }
 
   ESP_LOGD(TAG, "Connecting %s ...",
            this->protocol == SOCK_DGRAM ? "UDP" : "TCP");
@@ -23,6 +113,7 @@ void SocketTransmitter::send(const uint8_t *data, size_t length) {
                        this->port);
   if (this->socket_->connect(&destination, sizeof(destination)) < 0) {
     ESP_LOGE(TAG, "Failed to connect");
+    this->socket_->close();
     return;
   }
 
@@ -33,12 +124,179 @@ void SocketTransmitter::send(const uint8_t *data, size_t length) {
   this->socket_->close();
 }
 
+std::unique_ptr<socket::Socket> SocketTransmitter::open_socket_() {
+  auto sock = socket::socket_ip(this->protocol, 0);
+  if (!sock)
+    return sock;
+
+  int enable = 1;
+  sock->setsockopt(SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  if (!this->persistent_)
+    return sock;
+
+  sock->setblocking(false);
+  if (this->protocol == SOCK_STREAM) {
+    int nodelay = this->tcp_nodelay_;
+    sock->setsockopt(IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    int keepalive = this->keepalive_;
+    sock->setsockopt(SOL_SOCKET, SO_KEEPALIVE, &keepalive, sizeof(keepalive));
+  }
+  return sock;
+}
+
+void SocketTransmitter::connect_() {
+  this->socket_ = this->open_socket_();
+  if (!this->socket_) {
+    this->disconnect_("failed to create socket");
+    return;
+  }
+
+  ESP_LOGD(TAG, "Connecting %s to %s:%d ...",
+           this->protocol == SOCK_DGRAM ? "UDP" : "TCP", this->host.c_str(),
+           this->port);
+  sockaddr destination;
+  socket::set_sockaddr(&destination, sizeof(destination), this->host,
+                       this->port);
+  this->state_since_ = millis();
+  if (this->socket_->connect(&destination, sizeof(destination)) == 0) {
+    this->state_ = State::CONNECTED;
+    this->reconnect_delay_ = 0;
+    ESP_LOGI(TAG, "Connected to %s:%d", this->host.c_str(), this->port);
+  } else if (errno == EINPROGRESS) {
+    this->state_ = State::CONNECTING;
+  } else {
+    this->disconnect_(strerror(errno));
+  }
+}
+
+void SocketTransmitter::disconnect_(const char *reason) {
+  if (this->socket_) {
+    this->socket_->close();
+    this->socket_.reset();
+  }
+  // A partially written frame is sent again from its start on the next
+  // connection, the collector sees a new stream.
+  this->sent_offset_ = 0;
+  this->state_ = State::DISCONNECTED;
+  this->state_since_ = millis();
+  if (this->reconnect_delay_ == 0)
+    this->reconnect_delay_ = this->reconnect_min_ms_;
+  else
+    this->reconnect_delay_ =
+        std::min(this->reconnect_delay_ * 2, this->reconnect_max_ms_);
+  ESP_LOGW(TAG, "Connection to %s:%d lost (%s), retrying in %u ms",
+           this->host.c_str(), this->port, reason, this->reconnect_delay_);
+}
+
+bool SocketTransmitter::check_connected_() {
+  // Without a file descriptor there is no way to poll the handshake,
+  // writes report EAGAIN until it completes.
+  int fd = this->socket_->get_fd();
+  if (fd >= 0) {
+    fd_set writable;
+    FD_ZERO(&writable);
+    FD_SET(fd, &writable);
+    timeval timeout = {0, 0};
+    if (select(fd + 1, NULL, &writable, NULL, &timeout) <= 0)
+      return false;
+  }
+
+  int err = 0;
+  socklen_t len = sizeof(err);
+  if (this->socket_->getsockopt(SOL_SOCKET, SO_ERROR, &err, &len) < 0)
+    err = errno;
+  if (err != 0) {
+    this->disconnect_(strerror(err));
+    return false;
+  }
+  return true;
+}
+
+void SocketTransmitter::flush_() {
+  while (this->queue_count_ > 0) {
+    auto &frame = this->queue_[this->queue_head_];
+    ssize_t n_bytes =
+        this->socket_->write(frame.data() + this->sent_offset_,
+                             frame.size() - this->sent_offset_);
+    if (n_bytes < 0) {
+      if (!would_block(errno))
+        this->disconnect_(strerror(errno));
+      return;
+    }
+    this->sent_offset_ += n_bytes;
+    if (this->sent_offset_ < frame.size())
+      return;
+    ESP_LOGV(TAG, "Sent frame [%d bytes]", frame.size());
+    this->queue_head_ = (this->queue_head_ + 1) % this->queue_.size();
+    this->queue_count_--;
+    this->sent_offset_ = 0;
+  }
+}
+
+void SocketTransmitter::loop() {
+  if (this->batch_records_ > 0 &&
+      millis() - this->batch_started_ >= this->batch_max_delay_ms_)
+    this->flush_batch_();
+
+  if (!this->persistent_)
+    return;
+
+  switch (this->state_) {
+  case State::DISCONNECTED:
+    if (millis() - this->state_since_ >= this->reconnect_delay_)
+      this->connect_();
+    break;
+
+  case State::CONNECTING:
+    if (this->check_connected_()) {
+      this->state_ = State::CONNECTED;
+      this->reconnect_delay_ = 0;
+      ESP_LOGI(TAG, "Connected to %s:%d", this->host.c_str(), this->port);
+    } else if (this->state_ == State::CONNECTING &&
+               millis() - this->state_since_ >= CONNECT_TIMEOUT_MS) {
+      this->disconnect_("connect timeout");
+    }
+    break;
+
+  case State::CONNECTED:
+    this->flush_();
+    if (this->state_ == State::CONNECTED && this->protocol == SOCK_STREAM) {
+      // The collector is not expected to talk back, a read is only used to
+      // notice that it closed the connection.
+      uint8_t buffer[64];
+      ssize_t n_bytes = this->socket_->read(buffer, sizeof(buffer));
+      if (n_bytes == 0)
+        this->disconnect_("closed by peer");
+      else if (n_bytes < 0 && !would_block(errno))
+        this->disconnect_(strerror(errno));
+    }
+    break;
+  }
+}
+
 void SocketTransmitter::dump_config() {
   auto protocol = this->protocol == SOCK_DGRAM ? "UDP" : "TCP";
 
   ESP_LOGCONFIG(TAG, "Socket Transmitter:");
   ESP_LOGCONFIG(TAG, "  Destination: %s:%d", this->host.c_str(), this->port);
   ESP_LOGCONFIG(TAG, "  Protocol: %s", protocol);
+  ESP_LOGCONFIG(TAG, "  Framing: %s",
+                this->framing_ == Framing::LENGTH_PREFIXED ? "length prefixed"
+                                                           : "none");
+  if (this->batch_max_records_ > 1)
+    ESP_LOGCONFIG(TAG, "  Batch: %u frames, %u bytes, %u ms",
+                  this->batch_max_records_, this->batch_max_bytes_,
+                  this->batch_max_delay_ms_);
+  ESP_LOGCONFIG(TAG, "  Persistent: %s", YESNO(this->persistent_));
+  if (!this->persistent_)
+    return;
+  ESP_LOGCONFIG(TAG, "  Queue size: %u", this->queue_size_);
+  ESP_LOGCONFIG(TAG, "  Reconnect interval: %u - %u ms",
+                this->reconnect_min_ms_, this->reconnect_max_ms_);
+  if (this->protocol == SOCK_STREAM) {
+    ESP_LOGCONFIG(TAG, "  TCP nodelay: %s", YESNO(this->tcp_nodelay_));
+    ESP_LOGCONFIG(TAG, "  Keepalive: %s", YESNO(this->keepalive_));
+  }
 }
 } // namespace socket_transmitter
 } // namespace esphome
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "esphome/components/socket/socket.h"
@@ -11,24 +12,88 @@ namespace esphome {
 namespace socket_transmitter {
 static const char *TAG = "socket_transmitter";
 
+enum class Framing { NONE, LENGTH_PREFIXED };
+
 class SocketTransmitter : public Component {
 public:
   void set_host(std::string host) { this->host = host; };
   void set_port(int port) { this->port = port; };
   void set_protocol(int protocol) { this->protocol = protocol; };
-  void send(std::string data);
-  void send(std::vector<uint8_t> data);
+  void set_persistent(bool persistent) { this->persistent_ = persistent; };
+  void set_tcp_nodelay(bool tcp_nodelay) { this->tcp_nodelay_ = tcp_nodelay; };
+  void set_keepalive(bool keepalive) { this->keepalive_ = keepalive; };
+  void set_queue_size(size_t queue_size) { this->queue_size_ = queue_size; };
+  void set_reconnect_interval(uint32_t min_ms, uint32_t max_ms) {
+    this->reconnect_min_ms_ = min_ms;
+    this->reconnect_max_ms_ = max_ms;
+  };
+  void set_framing(Framing framing) { this->framing_ = framing; };
+  void set_batch(size_t max_records, size_t max_bytes, uint32_t max_delay_ms) {
+    this->batch_max_records_ = max_records;
+    this->batch_max_bytes_ = max_bytes;
+    this->batch_max_delay_ms_ = max_delay_ms;
+  };
+  void send(std::string_view data);
+  void send(const std::vector<uint8_t> &data);
   void send(const uint8_t *data, size_t length);
+  // Scratch buffer for serializing a payload in place before send(), it
+  // keeps its capacity between calls.
+  std::vector<uint8_t> &transmit_buffer() { return this->transmit_buffer_; }
+  void setup() override;
+  void loop() override;
   void dump_config() override;
   float get_setup_priority() const override {
     return setup_priority::AFTER_CONNECTION;
   }
 
 protected:
+  enum class State { DISCONNECTED, CONNECTING, CONNECTED };
+
+  void add_record_(const uint8_t *data, size_t length);
+  void flush_batch_();
+  void deliver_(const uint8_t *data, size_t length);
+  void send_once_(const uint8_t *data, size_t length);
+  std::unique_ptr<socket::Socket> open_socket_();
+  void connect_();
+  void disconnect_(const char *reason);
+  bool check_connected_();
+  void flush_();
+
   std::string host;
   int port;
   int protocol;
   std::unique_ptr<socket::Socket> socket_;
+
+  // Persistent connection mode: frames are queued by send() and written
+  // from loop() with non-blocking calls, so a slow or unreachable
+  // collector never stalls the caller.
+  bool persistent_{false};
+  bool tcp_nodelay_{true};
+  bool keepalive_{true};
+  size_t queue_size_{16};
+  uint32_t reconnect_min_ms_{1000};
+  uint32_t reconnect_max_ms_{60000};
+
+  // Records are collected into one payload until the count, size or delay
+  // limit is reached. The default limits send every record on its own.
+  Framing framing_{Framing::NONE};
+  size_t batch_max_records_{1};
+  size_t batch_max_bytes_{1400};
+  uint32_t batch_max_delay_ms_{0};
+  std::vector<uint8_t> batch_;
+  size_t batch_records_{0};
+  uint32_t batch_started_{0};
+
+  State state_{State::DISCONNECTED};
+  std::vector<std::vector<uint8_t>> queue_;
+  size_t queue_head_{0};
+  size_t queue_count_{0};
+  size_t sent_offset_{0};
+  uint32_t state_since_{0};
+  uint32_t reconnect_delay_{0};
+  uint32_t dropped_{0};
+
+  std::vector<uint8_t> transmit_buffer_;
 };
 
 template <typename StrOrVector, typename... Ts>
@@ -45,5 +110,28 @@ public:
 protected:
   SocketTransmitter *parent_;
 };
+
+// Lets the writer append the payload to the transmit buffer instead of
+// returning a new string or vector for every frame.
+template <typename... Ts>
+class SocketTransmitterWriteAction : public Action<Ts...> {
+public:
+  SocketTransmitterWriteAction(SocketTransmitter *parent) : parent_(parent) {}
+
+  void set_writer(std::function<void(std::vector<uint8_t> &, Ts...)> writer) {
+    this->writer_ = writer;
+  }
+
+  void play(const Ts& ... x) override {
+    auto &buffer = this->parent_->transmit_buffer();
+    buffer.clear();
+    this->writer_(buffer, x...);
+    this->parent_->send(buffer.data(), buffer.size());
+  }
+
+protected:
+  SocketTransmitter *parent_;
+  std::function<void(std::vector<uint8_t> &, Ts...)> writer_;
+};
 } // namespace socket_transmitter
 } // namespace esphome
@@ -5,6 +5,7 @@ from pathlib import Path
 
 CODEOWNERS = ["@SzczepanLeon", "@kubasaw"]
 CONF_DRIVERS = "drivers"
+CONF_AES_BACKEND = "aes_backend"
 
 wmbus_common_ns = cg.esphome_ns.namespace("wmbus_common")
 WMBusCommon = wmbus_common_ns.class_("WMBusCommon", cg.Component)
@@ -31,6 +32,10 @@ CONFIG_SCHEMA = cv.Schema(
             lambda x: AVAILABLE_DRIVERS if x == "all" else set(x) if isinstance(x, list) else x,
             {validate_driver},
         ),
+        # SOFTWARE is the bundled tiny-AES, MBEDTLS uses the ESP32 AES peripheral
+        cv.Optional(CONF_AES_BACKEND, default="SOFTWARE"): cv.one_of(
+            "MBEDTLS", "SOFTWARE", upper=True
+        ),
     }
 )
 
@@ -49,6 +54,9 @@ async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID], sorted(_registered_drivers))
     await cg.register_component(var, config)
 
+    if config[CONF_AES_BACKEND] == "MBEDTLS":
+        cg.add_build_flag("-DWMBUS_AES_MBEDTLS")
+
     # Reference each selected driver's KEEP_DRIVER symbol from main.cpp so the
     # linker keeps its object file; see KEEP_DRIVER in meters.h.
     drivers = sorted(_registered_drivers)
@@ -2,6 +2,7 @@
 #include "esphome/core/log.h"
 
 #include "_version.h"
+#include "startup_profiler.h"
 
 namespace esphome {
 namespace wmbus_common {
@@ -12,9 +13,21 @@ public:
   void dump_config() override {
     ESP_LOGCONFIG(TAG, "wM-Bus Component v%s-%s:", WMBUS_COMPONENT_VERSION,
                   WMBUSMETERS_VERSION);
+#ifdef WMBUS_AES_MBEDTLS
+    ESP_LOGCONFIG(TAG, "  AES backend: mbedTLS");
+#else
+    ESP_LOGCONFIG(TAG, "  AES backend: software");
+#endif
     ESP_LOGCONFIG(TAG, "  Loaded drivers:");
     for (const auto &driver : this->drivers_)
       ESP_LOGCONFIG(TAG, "   %s", driver.c_str());
+    ESP_LOGCONFIG(TAG, "  Startup profile:");
+    for (const StartupPhase &phase : startupPhases())
+      ESP_LOGCONFIG(TAG,
+                    "   %*s%s: %.3f ms, heap %+d B, at %.1f ms, %u time(s)",
+                    phase.depth * 2, "", phase.name.c_str(),
+                    phase.duration_us / 1000.0, (int)phase.heap_bytes,
+                    phase.start_us / 1000.0, (unsigned)phase.count);
   }
 
 protected:
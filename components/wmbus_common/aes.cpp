@@ -43,6 +43,8 @@ NOTE:   String length must be evenly divisible by 16byte (str_len % 16 == 0)
 #include <stdint.h>
 #include <string.h> // CBC mode, for memset
 
+#ifndef WMBUS_AES_MBEDTLS
+
 /*****************************************************************************/
 /* Defines:                                                                  */
 /*****************************************************************************/
@@ -81,18 +83,6 @@ NOTE:   String length must be evenly divisible by 16byte (str_len % 16 == 0)
 /*****************************************************************************/
 // state - array holding the intermediate results during decryption.
 typedef uint8_t state_t[4][4];
-static state_t *state;
-
-// The array that stores the round keys.
-static uint8_t RoundKey[keyExpSize];
-
-// The Key input to the AES Program
-static const uint8_t *Key;
-
-#if defined(CBC) && CBC
-// Initial Vector used only for CBC mode
-static uint8_t *Iv;
-#endif
 
 // The lookup-tables are marked const so they can be placed in read-only storage
 // instead of RAM The numbers below can be computed dynamically trading ROM for
@@ -197,7 +187,7 @@ static uint8_t getSBoxInvert(uint8_t num) { return rsbox[num]; }
 
 // This function produces Nb(Nr+1) round keys. The round keys are used in each
 // round to decrypt the states.
-static void KeyExpansion(void) {
+static void KeyExpansion(uint8_t *RoundKey, const uint8_t *Key) {
   uint32_t i, k;
   uint8_t tempa[4]; // Used for the column/row operations
 
@@ -265,7 +255,8 @@ static void KeyExpansion(void) {
 
 // This function adds the round key to state.
 // The round key is added to the state by an XOR function.
-static void AddRoundKey(uint8_t round) {
+static void AddRoundKey(uint8_t round, state_t *state,
+                        const uint8_t *RoundKey) {
   uint8_t i, j;
   for (i = 0; i < 4; ++i) {
     for (j = 0; j < 4; ++j) {
@@ -276,7 +267,7 @@ static void AddRoundKey(uint8_t round) {
 
 // The SubBytes Function Substitutes the values in the
 // state matrix with values in an S-box.
-static void SubBytes(void) {
+static void SubBytes(state_t *state) {
   uint8_t i, j;
   for (i = 0; i < 4; ++i) {
     for (j = 0; j < 4; ++j) {
@@ -288,7 +279,7 @@ static void SubBytes(void) {
 // The ShiftRows() function shifts the rows in the state to the left.
 // Each row is shifted with different offset.
 // Offset = Row number. So the first row is not shifted.
-static void ShiftRows(void) {
+static void ShiftRows(state_t *state) {
   uint8_t temp;
 
   // Rotate first row 1 columns to left
@@ -318,7 +309,7 @@ static void ShiftRows(void) {
 static uint8_t xtime(uint8_t x) { return ((x << 1) ^ (((x >> 7) & 1) * 0x1b)); }
 
 // MixColumns function mixes the columns of the state matrix
-static void MixColumns(void) {
+static void MixColumns(state_t *state) {
   uint8_t i;
   uint8_t Tmp, Tm, t;
   for (i = 0; i < 4; ++i) {
@@ -359,7 +350,7 @@ static uint8_t Multiply(uint8_t x, uint8_t y) {
 // MixColumns function mixes the columns of the state matrix.
 // The method used to multiply may be difficult to understand for the
 // inexperienced. Please use the references to gain more information.
-static void InvMixColumns(void) {
+static void InvMixColumns(state_t *state) {
   int i;
   uint8_t a, b, c, d;
   for (i = 0; i < 4; ++i) {
@@ -381,7 +372,7 @@ static void InvMixColumns(void) {
 
 // The SubBytes Function Substitutes the values in the
 // state matrix with values in an S-box.
-static void InvSubBytes(void) {
+static void InvSubBytes(state_t *state) {
   uint8_t i, j;
   for (i = 0; i < 4; ++i) {
     for (j = 0; j < 4; ++j) {
@@ -390,7 +381,7 @@ static void InvSubBytes(void) {
   }
 }
 
-static void InvShiftRows(void) {
+static void InvShiftRows(state_t *state) {
   uint8_t temp;
 
   // Rotate first row 1 columns to right
@@ -418,89 +409,86 @@ static void InvShiftRows(void) {
 }
 
 // Cipher is the main function that encrypts the PlainText.
-static void Cipher(void) {
+static void Cipher(state_t *state, const uint8_t *RoundKey) {
   uint8_t round = 0;
 
   // Add the First round key to the state before starting the rounds.
-  AddRoundKey(0);
+  AddRoundKey(0, state, RoundKey);
 
   // There will be Nr rounds.
   // The first Nr-1 rounds are identical.
   // These Nr-1 rounds are executed in the loop below.
   for (round = 1; round < Nr; ++round) {
-    SubBytes();
-    ShiftRows();
-    MixColumns();
-    AddRoundKey(round);
+    SubBytes(state);
+    ShiftRows(state);
+    MixColumns(state);
+    AddRoundKey(round, state, RoundKey);
   }
 
   // The last round is given below.
   // The MixColumns function is not here in the last round.
-  SubBytes();
-  ShiftRows();
-  AddRoundKey(Nr);
+  SubBytes(state);
+  ShiftRows(state);
+  AddRoundKey(Nr, state, RoundKey);
 }
 
-static void InvCipher(void) {
+static void InvCipher(state_t *state, const uint8_t *RoundKey) {
   uint8_t round = 0;
 
   // Add the First round key to the state before starting the rounds.
-  AddRoundKey(Nr);
+  AddRoundKey(Nr, state, RoundKey);
 
   // There will be Nr rounds.
   // The first Nr-1 rounds are identical.
   // These Nr-1 rounds are executed in the loop below.
   for (round = (Nr - 1); round > 0; --round) {
-    InvShiftRows();
-    InvSubBytes();
-    AddRoundKey(round);
-    InvMixColumns();
+    InvShiftRows(state);
+    InvSubBytes(state);
+    AddRoundKey(round, state, RoundKey);
+    InvMixColumns(state);
   }
 
   // The last round is given below.
   // The MixColumns function is not here in the last round.
-  InvShiftRows();
-  InvSubBytes();
-  AddRoundKey(0);
+  InvShiftRows(state);
+  InvSubBytes(state);
+  AddRoundKey(0, state, RoundKey);
 }
 
 /*****************************************************************************/
 /* Public functions:                                                         */
 /*****************************************************************************/
+void AES_init_ctx(AesContext *ctx, const uint8_t *key) {
+  KeyExpansion(ctx->round_key, key);
+}
+
 #if defined(ECB) && (ECB == 1)
 
-void AES_ECB_encrypt(const uint8_t *input, const uint8_t *key, uint8_t *output,
-                     const uint32_t length) {
+bool AES_ECB_encrypt(const AesContext *ctx, const uint8_t *input,
+                     uint8_t *output) {
+  if (ctx == NULL)
+    return false;
   // Copy input to output, and work in-memory on output
-  memcpy(output, input, length);
-  state = (state_t *)output;
-
-  Key = key;
-  KeyExpansion();
-
-  // The next function call encrypts the PlainText with the Key using AES
-  // algorithm.
-  Cipher();
+  memcpy(output, input, BLOCKLEN);
+  Cipher((state_t *)output, ctx->round_key);
+  return true;
 }
 
-void AES_ECB_decrypt(const uint8_t *input, const uint8_t *key, uint8_t *output,
-                     const uint32_t length) {
+bool AES_ECB_decrypt(const AesContext *ctx, const uint8_t *input,
+                     uint8_t *output) {
+  if (ctx == NULL)
+    return false;
   // Copy input to output, and work in-memory on output
-  memcpy(output, input, length);
-  state = (state_t *)output;
-
-  // The KeyExpansion routine must be called before encryption.
-  Key = key;
-  KeyExpansion();
-
-  InvCipher();
+  memcpy(output, input, BLOCKLEN);
+  InvCipher((state_t *)output, ctx->round_key);
+  return true;
 }
 
 #endif // #if defined(ECB) && (ECB == 1)
 
 #if defined(CBC) && (CBC == 1)
 
-static void XorWithIv(uint8_t *buf) {
+static void XorWithIv(uint8_t *buf, const uint8_t *Iv) {
   uint8_t i;
   for (i = 0; i < BLOCKLEN; ++i) // WAS for(i = 0; i < KEYLEN; ++i) but the
                                  // block in AES is always 128bit so 16 bytes!
@@ -509,74 +497,91 @@ static void XorWithIv(uint8_t *buf) {
   }
 }
 
-void AES_CBC_encrypt_buffer(uint8_t *output, uint8_t *input, uint32_t length,
-                            const uint8_t *key, const uint8_t *iv) {
-  uintptr_t i;
-  //  uint8_t extra = length % BLOCKLEN; /* Remaining bytes in the last non-full
-  //  block */
+bool AES_CBC_encrypt_buffer(const AesContext *ctx, uint8_t *output,
+                            const uint8_t *input, uint32_t length,
+                            const uint8_t *iv) {
+  if (ctx == NULL)
+    return false;
 
-  // Skip the key expansion if key is passed as 0
-  if (0 != key) {
-    Key = key;
-    KeyExpansion();
-  }
-
-  if (iv != 0) {
-    Iv = (uint8_t *)iv;
-  }
+  uintptr_t i;
+  const uint8_t *Iv = iv;
 
   for (i = 0; i < length; i += BLOCKLEN) {
-    XorWithIv(input);
     memcpy(output, input, BLOCKLEN);
-    state = (state_t *)output;
-    Cipher();
+    XorWithIv(output, Iv);
+    Cipher((state_t *)output, ctx->round_key);
     Iv = output;
     input += BLOCKLEN;
     output += BLOCKLEN;
-    // printf("Step %d - %d", i/16, i);
   }
-
-  /*  if (extra)
-    {
-      memcpy(output, input, extra);
-      state = (state_t*)output;
-      Cipher();
-      } */
+  return true;
 }
 
-void AES_CBC_decrypt_buffer(uint8_t *output, uint8_t *input, uint32_t length,
-                            const uint8_t *key, const uint8_t *iv) {
-  uintptr_t i;
-  //  uint8_t extra = length % BLOCKLEN; /* Remaining bytes in the last non-full
-  //  block */
-
-  // Skip the key expansion if key is passed as 0
-  if (0 != key) {
-    Key = key;
-    KeyExpansion();
-  }
+bool AES_CBC_decrypt_buffer(const AesContext *ctx, uint8_t *output,
+                            const uint8_t *input, uint32_t length,
+                            const uint8_t *iv) {
+  if (ctx == NULL)
+    return false;
 
-  // If iv is passed as 0, we continue to encrypt without re-setting the Iv
-  if (iv != 0) {
-    Iv = (uint8_t *)iv;
-  }
+  uintptr_t i;
+  uint8_t Iv[BLOCKLEN];
+  uint8_t next_iv[BLOCKLEN];
+  memcpy(Iv, iv, BLOCKLEN);
 
+  // Keep a copy of the cipher block, output may be the same buffer as input.
   for (i = 0; i < length; i += BLOCKLEN) {
+    memcpy(next_iv, input, BLOCKLEN);
     memcpy(output, input, BLOCKLEN);
-    state = (state_t *)output;
-    InvCipher();
-    XorWithIv(output);
-    Iv = input;
+    InvCipher((state_t *)output, ctx->round_key);
+    XorWithIv(output, Iv);
+    memcpy(Iv, next_iv, BLOCKLEN);
     input += BLOCKLEN;
     output += BLOCKLEN;
   }
+  return true;
+}
 
-  /*  if (extra)
-    {
-      memcpy(output, input, extra);
-      state = (state_t*)output;
-      InvCipher();
-      }*/
+#endif // #if defined(CBC) && (CBC == 1)
+
+#endif // #ifndef WMBUS_AES_MBEDTLS
+
+/*****************************************************************************/
+/* Backend independent:                                                      */
+/*****************************************************************************/
+#if defined(ECB) && (ECB == 1)
+
+void AES_ECB_encrypt(const uint8_t *input, const uint8_t *key, uint8_t *output,
+                     const uint32_t length) {
+  AesContext ctx;
+  AES_init_ctx(&ctx, key);
+  for (uint32_t i = 0; i + AES_BLOCKLEN <= length; i += AES_BLOCKLEN)
+    AES_ECB_encrypt(&ctx, input + i, output + i);
+}
+
+void AES_ECB_decrypt(const uint8_t *input, const uint8_t *key, uint8_t *output,
+                     const uint32_t length) {
+  AesContext ctx;
+  AES_init_ctx(&ctx, key);
+  for (uint32_t i = 0; i + AES_BLOCKLEN <= length; i += AES_BLOCKLEN)
+    AES_ECB_decrypt(&ctx, input + i, output + i);
+}
+
+#endif // #if defined(ECB) && (ECB == 1)
+
+#if defined(CBC) && (CBC == 1)
+
+void AES_CBC_encrypt_buffer(uint8_t *output, uint8_t *input, uint32_t length,
+                            const uint8_t *key, const uint8_t *iv) {
+  AesContext ctx;
+  AES_init_ctx(&ctx, key);
+  AES_CBC_encrypt_buffer(&ctx, output, input, length, iv);
+}
+
+void AES_CBC_decrypt_buffer(uint8_t *output, uint8_t *input, uint32_t length,
+                            const uint8_t *key, const uint8_t *iv) {
+  AesContext ctx;
+  AES_init_ctx(&ctx, key);
+  AES_CBC_decrypt_buffer(&ctx, output, input, length, iv);
 }
 
 #endif // #if defined(CBC) && (CBC == 1)
@@ -26,8 +26,50 @@
 //#define AES192 1
 //#define AES256 1
 
+#define AES_BLOCKLEN 16
+#define AES_keyExpSize 176
+
+// Backend is selected at build time: define WMBUS_AES_MBEDTLS to use
+// mbedTLS (aes_mbedtls.cpp, hardware accelerated on ESP32), otherwise the
+// portable tiny-AES code in aes.cpp is used.
+//
+// Expanded key schedule. Expand a key once with AES_init_ctx and reuse the
+// context: nothing is kept in globals, so the functions below are reentrant.
+#ifdef WMBUS_AES_MBEDTLS
+#include "mbedtls/aes.h"
+
+struct AesContext {
+  AesContext() {
+    mbedtls_aes_init(&enc);
+    mbedtls_aes_init(&dec);
+  }
+  ~AesContext() {
+    mbedtls_aes_free(&enc);
+    mbedtls_aes_free(&dec);
+  }
+  AesContext(const AesContext &) = delete;
+  AesContext &operator=(const AesContext &) = delete;
+
+  mbedtls_aes_context enc;
+  mbedtls_aes_context dec;
+};
+#else
+struct AesContext {
+  uint8_t round_key[AES_keyExpSize];
+};
+#endif
+
+void AES_init_ctx(AesContext *ctx, const uint8_t *key);
+
 #if defined(ECB) && (ECB == 1)
 
+// Single 16 byte block. Returns false if ctx is NULL, i.e. there is no key.
+bool AES_ECB_encrypt(const AesContext *ctx, const uint8_t *input,
+                     uint8_t *output);
+bool AES_ECB_decrypt(const AesContext *ctx, const uint8_t *input,
+                     uint8_t *output);
+
+// Expands the key and processes length / 16 blocks, each on its own.
 void AES_ECB_encrypt(const uint8_t *input, const uint8_t *key, uint8_t *output,
                      const uint32_t length);
 void AES_ECB_decrypt(const uint8_t *input, const uint8_t *key, uint8_t *output,
@@ -37,6 +79,16 @@ void AES_ECB_decrypt(const uint8_t *input, const uint8_t *key, uint8_t *output,
 
 #if defined(CBC) && (CBC == 1)
 
+// Length must be a multiple of 16. Output may be the same buffer as input.
+// Returns false if ctx is NULL, i.e. there is no key.
+bool AES_CBC_encrypt_buffer(const AesContext *ctx, uint8_t *output,
+                            const uint8_t *input, uint32_t length,
+                            const uint8_t *iv);
+bool AES_CBC_decrypt_buffer(const AesContext *ctx, uint8_t *output,
+                            const uint8_t *input, uint32_t length,
+                            const uint8_t *iv);
+
+// As above, but expands the key on every call.
 void AES_CBC_encrypt_buffer(uint8_t *output, uint8_t *input, uint32_t length,
                             const uint8_t *key, const uint8_t *iv);
 void AES_CBC_decrypt_buffer(uint8_t *output, uint8_t *input, uint32_t length,
@@ -0,0 +1,55 @@
+// mbedTLS backend for the AES functions in aes.h, selected with
+// WMBUS_AES_MBEDTLS. On ESP32 mbedTLS runs on the AES peripheral.
+#include "aes.h"
+
+#ifdef WMBUS_AES_MBEDTLS
+
+#include <string.h>
+
+void AES_init_ctx(AesContext *ctx, const uint8_t *key) {
+  mbedtls_aes_setkey_enc(&ctx->enc, key, 128);
+  mbedtls_aes_setkey_dec(&ctx->dec, key, 128);
+}
+
+bool AES_ECB_encrypt(const AesContext *ctx, const uint8_t *input,
+                     uint8_t *output) {
+  if (ctx == NULL)
+    return false;
+  return mbedtls_aes_crypt_ecb(const_cast<mbedtls_aes_context *>(&ctx->enc),
+                               MBEDTLS_AES_ENCRYPT, input, output) == 0;
+}
+
+bool AES_ECB_decrypt(const AesContext *ctx, const uint8_t *input,
+                     uint8_t *output) {
+  if (ctx == NULL)
+    return false;
+  return mbedtls_aes_crypt_ecb(const_cast<mbedtls_aes_context *>(&ctx->dec),
+                               MBEDTLS_AES_DECRYPT, input, output) == 0;
+}
+
+bool AES_CBC_encrypt_buffer(const AesContext *ctx, uint8_t *output,
+                            const uint8_t *input, uint32_t length,
+                            const uint8_t *iv) {
+  if (ctx == NULL)
+    return false;
+  // mbedTLS updates the iv
+  uint8_t iv_copy[AES_BLOCKLEN];
+  memcpy(iv_copy, iv, AES_BLOCKLEN);
+  return mbedtls_aes_crypt_cbc(const_cast<mbedtls_aes_context *>(&ctx->enc),
+                               MBEDTLS_AES_ENCRYPT, length, iv_copy, input,
+                               output) == 0;
+}
+
+bool AES_CBC_decrypt_buffer(const AesContext *ctx, uint8_t *output,
+                            const uint8_t *input, uint32_t length,
+                            const uint8_t *iv) {
+  if (ctx == NULL)
+    return false;
+  uint8_t iv_copy[AES_BLOCKLEN];
+  memcpy(iv_copy, iv, AES_BLOCKLEN);
+  return mbedtls_aes_crypt_cbc(const_cast<mbedtls_aes_context *>(&ctx->dec),
+                               MBEDTLS_AES_DECRYPT, length, iv_copy, input,
+                               output) == 0;
+}
+
+#endif // WMBUS_AES_MBEDTLS
@@ -24,14 +24,15 @@
 uchar vec87[16] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
                    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x87};
 
-void generateSubkeys(uchar *key, uchar *K1, uchar *K2) {
+bool generateSubkeys(const AesContext *ctx, uchar *K1, uchar *K2) {
   uchar L[16];
   uchar Z[16];
   uchar tmp[16];
 
   memset(Z, 0, 16);
 
-  AES_ECB_encrypt(Z, key, L, 16);
+  if (!AES_ECB_encrypt(ctx, Z, L))
+    return false;
 
   if (!(L[0] & 0x80)) {
     shiftLeft(L, K1, 16);
@@ -46,6 +47,7 @@ void generateSubkeys(uchar *key, uchar *K1, uchar *K2) {
     shiftLeft(K1, tmp, 16);
     xorit(tmp, vec87, K2, 16);
   }
+  return true;
 }
 
 void pad(uchar *in, uchar *out, int len) {
@@ -60,13 +62,20 @@ void pad(uchar *in, uchar *out, int len) {
   }
 }
 
-void AES_CMAC(uchar *key, uchar *input, int len, uchar *mac) {
+bool AES_CMAC(uchar *key, uchar *input, int len, uchar *mac) {
+  AesContext ctx;
+  AES_init_ctx(&ctx, key);
+  return AES_CMAC(&ctx, input, len, mac);
+}
+
+bool AES_CMAC(const AesContext *ctx, uchar *input, int len, uchar *mac) {
   bool len_is_multiple_of_block;
   uchar X[16], Y[16];
   uchar K1[16], K2[16];
   uchar M_last[16], padded[16];
 
-  generateSubkeys(key, K1, K2);
+  if (!generateSubkeys(ctx, K1, K2))
+    return false;
 
   int num_blocks = (len + 15) / 16;
 
@@ -88,11 +97,14 @@ void AES_CMAC(uchar *key, uchar *input, int len, uchar *mac) {
 
   for (int i = 0; i < num_blocks - 1; i++) {
     xorit(X, input + (16 * i), Y, 16);
-    AES_ECB_encrypt(Y, key, X, 16);
+    if (!AES_ECB_encrypt(ctx, Y, X))
+      return false;
   }
 
   xorit(X, M_last, Y, 16);
-  AES_ECB_encrypt(Y, key, X, 16);
+  if (!AES_ECB_encrypt(ctx, Y, X))
+    return false;
 
   memcpy(mac, X, 16);
+  return true;
 }
@@ -18,8 +18,12 @@
 #ifndef _AESCMAC_H_
 #define _AESCMAC_H_
 
+#include "aes.h"
+
 typedef unsigned char uchar;
 
-void AES_CMAC(uchar *key, uchar *input, int length, uchar *mac);
+// Returns false if ctx is NULL, i.e. there is no key.
+bool AES_CMAC(uchar *key, uchar *input, int length, uchar *mac);
+bool AES_CMAC(const AesContext *ctx, uchar *input, int length, uchar *mac);
 
 #endif //_AESCMAC_H_
@@ -19,6 +19,7 @@
 #include "util.h"
 #include "wmbus.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <cmath>
 #include <limits>
@@ -572,13 +573,16 @@ bool parseDV(Telegram *t, std::vector<uchar> &databytes,
       datalen = remaining - 1;
     }
 
-    std::string value = bin2hex(data, data_end, datalen);
+    size_t value_len =
+        std::min<size_t>(std::max(datalen, 0), std::distance(data, data_end));
     int offset = start_parse_here + data - data_start;
 
     (*dv_entries)[key] = {
-        offset, DVEntry(offset, key, mt, Vif(full_vif), found_combinable_vifs,
-                        found_combinable_vifs_raw, StorageNr(storage_nr),
-                        TariffNr(tariff), SubUnitNr(subunit), value)};
+        offset,
+        DVEntry(offset, key, mt, Vif(full_vif), found_combinable_vifs,
+                found_combinable_vifs_raw, StorageNr(storage_nr),
+                TariffNr(tariff), SubUnitNr(subunit), databytes,
+                std::distance(databytes.begin(), data), value_len)};
 
     DVEntry *dve = &(*dv_entries)[key].second;
 
@@ -586,12 +590,10 @@ bool parseDV(Telegram *t, std::vector<uchar> &databytes,
 
     assert(key == dve->dif_vif_key.str());
 
-    if (value.length() > 0) {
+    if (value_len > 0) {
       // This call increments data with datalen.
-      t->addExplanationAndIncrementPos(data, datalen, KindOfData::CONTENT,
-                                       Understanding::NONE, "%s",
-                                       value.c_str());
-      DEBUG_PARSER("(dvparser debug) data \"%s\"\n\n", value.c_str());
+      t->addValueExplanationAndIncrementPos(data, datalen);
+      DEBUG_PARSER("(dvparser debug) data \"%s\"\n\n", dve->value().c_str());
     }
     if (remaining == datalen || data == databytes.end()) {
       // We are done here!
@@ -721,8 +723,14 @@ bool extractDVuint8(std::map<std::string, std::pair<int, DVEntry>> *dv_entries,
 
   std::pair<int, DVEntry> &p = (*dv_entries)[key];
   *offset = p.first;
-  std::vector<uchar> v;
-  hex2bin(p.second.value, &v);
+  if (p.second.valueLength() < 1) {
+    verbose("(dvparser) warning: too little data to extract uint8 from key "
+            "\"%s\"\n",
+            key.c_str());
+    *value = 0;
+    return false;
+  }
+  const uchar *v = p.second.valueBytes();
 
   *value = v[0];
   return true;
@@ -741,8 +749,14 @@ bool extractDVuint16(std::map<std::string, std::pair<int, DVEntry>> *dv_entries,
 
   std::pair<int, DVEntry> &p = (*dv_entries)[key];
   *offset = p.first;
-  std::vector<uchar> v;
-  hex2bin(p.second.value, &v);
+  if (p.second.valueLength() < 2) {
+    verbose("(dvparser) warning: too little data to extract uint16 from key "
+            "\"%s\"\n",
+            key.c_str());
+    *value = 0;
+    return false;
+  }
+  const uchar *v = p.second.valueBytes();
 
   *value = v[1] << 8 | v[0];
   return true;
@@ -761,8 +775,14 @@ bool extractDVuint24(std::map<std::string, std::pair<int, DVEntry>> *dv_entries,
 
   std::pair<int, DVEntry> &p = (*dv_entries)[key];
   *offset = p.first;
-  std::vector<uchar> v;
-  hex2bin(p.second.value, &v);
+  if (p.second.valueLength() < 3) {
+    verbose("(dvparser) warning: too little data to extract uint24 from key "
+            "\"%s\"\n",
+            key.c_str());
+    *value = 0;
+    return false;
+  }
+  const uchar *v = p.second.valueBytes();
 
   *value = v[2] << 16 | v[1] << 8 | v[0];
   return true;
@@ -781,8 +801,14 @@ bool extractDVuint32(std::map<std::string, std::pair<int, DVEntry>> *dv_entries,
 
   std::pair<int, DVEntry> &p = (*dv_entries)[key];
   *offset = p.first;
-  std::vector<uchar> v;
-  hex2bin(p.second.value, &v);
+  if (p.second.valueLength() < 4) {
+    verbose("(dvparser) warning: too little data to extract uint32 from key "
+            "\"%s\"\n",
+            key.c_str());
+    *value = 0;
+    return false;
+  }
+  const uchar *v = p.second.valueBytes();
 
   *value = (uint32_t(v[3]) << 24) | (uint32_t(v[2]) << 16) |
            (uint32_t(v[1]) << 8) | uint32_t(v[0]);
@@ -803,7 +829,7 @@ bool extractDVdouble(std::map<std::string, std::pair<int, DVEntry>> *dv_entries,
   std::pair<int, DVEntry> &p = (*dv_entries)[key];
   *offset = p.first;
 
-  if (p.second.value.length() == 0) {
+  if (p.second.valueLength() == 0) {
     verbose("(dvparser) warning: key found but no data  \"%s\"\n", key.c_str());
     *offset = 0;
     *value = 0;
@@ -813,26 +839,54 @@ bool extractDVdouble(std::map<std::string, std::pair<int, DVEntry>> *dv_entries,
   return p.second.extractDouble(value, auto_scale, force_unsigned);
 }
 
-bool checkSizeHex(size_t expected_len, DifVifKey &dvk, std::string &v) {
-  if (v.length() == expected_len)
+bool checkSize(size_t expected_len, DVEntry &dve) {
+  if (dve.valueLength() == expected_len)
     return true;
 
   warning("(dvparser) bad decode since difvif %s expected %d hex chars but got "
           "\"%s\"\n",
-          dvk.str().c_str(), expected_len, v.c_str());
+          dve.dif_vif_key.str().c_str(), expected_len * 2,
+          dve.value().c_str());
   return false;
 }
 
-bool is_all_F(std::string &v) {
-  for (size_t i = 0; i < v.length(); ++i) {
-    if (v[i] != 'F')
+bool isAllFF(const uchar *v, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    if (v[i] != 0xff)
       return false;
   }
   return true;
 }
 
+// Integers are stored least significant byte first.
+uint64_t decodeBinary(const uchar *v, size_t len) {
+  uint64_t raw = 0;
+  for (size_t i = len; i > 0; --i) {
+    raw = raw << 8 | v[i - 1];
+  }
+  return raw;
+}
+
+// Bcd is stored least significant byte first as well, 74140000 -> 00001474.
+// Negative bcd values have the top nibble set to F.
+uint64_t decodeBCD(const uchar *v, size_t len, bool *negate) {
+  uint64_t raw = 0;
+  *negate = (v[len - 1] & 0xf0) == 0xf0;
+  for (size_t i = len; i > 0; --i) {
+    uchar hi = v[i - 1] >> 4;
+    uchar lo = v[i - 1] & 0x0f;
+    if (i == len && *negate)
+      hi = 0;
+    raw = raw * 100 + hi * 10 + lo;
+  }
+  return raw;
+}
+
 bool DVEntry::extractDouble(double *out, bool auto_scale, bool force_unsigned) {
   int t = dif_vif_key.dif() & 0xf;
+  const uchar *v = valueBytes();
+  size_t len = difLenBytes(dif_vif_key.dif());
+
   if (t == 0x0 || t == 0x8 || t == 0xd || t == 0xf) {
     // Cannot extract from nothing, selection for readout, variable length or
     // special. Variable length is used for compact varlen history. Should be
@@ -845,81 +899,16 @@ bool DVEntry::extractDouble(double *out, bool auto_scale, bool force_unsigned) {
              t == 0x6 || // 48 Bit Integer/Binary
              t == 0x7)   // 64 Bit Integer/Binary
   {
-    std::vector<uchar> v;
-    hex2bin(value, &v);
-    uint64_t raw = 0;
-    bool negate = false;
-    uint64_t negate_mask = 0;
-    if (t == 0x1) {
-      if (!checkSizeHex(2, dif_vif_key, value))
-        return false;
-      assert(v.size() == 1);
-      raw = v[0];
-      if (!force_unsigned && (raw & (uint64_t)0x80UL) != 0) {
-        negate = true;
-        negate_mask = ~((uint64_t)0) << 8;
-      }
-    } else if (t == 0x2) {
-      if (!checkSizeHex(4, dif_vif_key, value))
-        return false;
-      assert(v.size() == 2);
-      raw = v[1] * 256 + v[0];
-      if (!force_unsigned && (raw & (uint64_t)0x8000UL) != 0) {
-        negate = true;
-        negate_mask = ~((uint64_t)0) << 16;
-      }
-    } else if (t == 0x3) {
-      if (!checkSizeHex(6, dif_vif_key, value))
-        return false;
-      assert(v.size() == 3);
-      raw = v[2] * 256 * 256 + v[1] * 256 + v[0];
-      if (!force_unsigned && (raw & (uint64_t)0x800000UL) != 0) {
-        negate = true;
-        negate_mask = ~((uint64_t)0) << 24;
-      }
-    } else if (t == 0x4) {
-      if (!checkSizeHex(8, dif_vif_key, value))
-        return false;
-      assert(v.size() == 4);
-      raw = ((unsigned int)v[3]) * 256 * 256 * 256 +
-            ((unsigned int)v[2]) * 256 * 256 + ((unsigned int)v[1]) * 256 +
-            ((unsigned int)v[0]);
-      if (!force_unsigned && (raw & (uint64_t)0x80000000UL) != 0) {
-        negate = true;
-        negate_mask = ~((uint64_t)0) << 32;
-      }
-    } else if (t == 0x6) {
-      if (!checkSizeHex(12, dif_vif_key, value))
-        return false;
-      assert(v.size() == 6);
-      raw = ((uint64_t)v[5]) * 256 * 256 * 256 * 256 * 256 +
-            ((uint64_t)v[4]) * 256 * 256 * 256 * 256 +
-            ((uint64_t)v[3]) * 256 * 256 * 256 + ((uint64_t)v[2]) * 256 * 256 +
-            ((uint64_t)v[1]) * 256 + ((uint64_t)v[0]);
-      if (!force_unsigned && (raw & (uint64_t)0x800000000000UL) != 0) {
-        negate = true;
-        negate_mask = ~((uint64_t)0) << 48;
-      }
-    } else if (t == 0x7) {
-      if (!checkSizeHex(16, dif_vif_key, value))
-        return false;
-      assert(v.size() == 8);
-      raw = ((uint64_t)v[7]) * 256 * 256 * 256 * 256 * 256 * 256 * 256 +
-            ((uint64_t)v[6]) * 256 * 256 * 256 * 256 * 256 * 256 +
-            ((uint64_t)v[5]) * 256 * 256 * 256 * 256 * 256 +
-            ((uint64_t)v[4]) * 256 * 256 * 256 * 256 +
-            ((uint64_t)v[3]) * 256 * 256 * 256 + ((uint64_t)v[2]) * 256 * 256 +
-            ((uint64_t)v[1]) * 256 + ((uint64_t)v[0]);
-      if (!force_unsigned && (raw & (uint64_t)0x8000000000000000UL) != 0) {
-        negate = true;
-        negate_mask = 0;
-      }
-    }
-    double scale = 1.0;
+    if (!checkSize(len, *this))
+      return false;
+    uint64_t raw = decodeBinary(v, len);
     double draw = (double)raw;
-    if (negate) {
+    if (!force_unsigned && (v[len - 1] & 0x80) != 0) {
+      // Sign extend the two's complement value to 64 bits.
+      uint64_t negate_mask = len < 8 ? ~((uint64_t)0) << (len * 8) : 0;
       draw = (double)((int64_t)(negate_mask | raw));
     }
+    double scale = 1.0;
     if (auto_scale)
       scale = vifScale(dif_vif_key.vif());
     *out = (draw) / scale;
@@ -930,72 +919,15 @@ bool DVEntry::extractDouble(double *out, bool auto_scale, bool force_unsigned) {
              t == 0xE)   // 12 digit BCD
   {
     // Negative BCD values are always visible in bcd. I.e. they are always
-    // signed. Ignore assumption on signedness. 74140000 -> 00001474
-    std::string &v = value;
-    uint64_t raw = 0;
-    bool negate = false;
-
-    if (is_all_F(v)) {
+    // signed. Ignore assumption on signedness.
+    if (isAllFF(v, valueLength())) {
       *out = std::nan("");
       return false;
     }
-    if (t == 0x9) {
-      if (!checkSizeHex(2, dif_vif_key, v))
-        return false;
-      if (v[0] == 'F') {
-        negate = true;
-        v[0] = '0';
-      }
-      raw = (v[0] - '0') * 10 + (v[1] - '0');
-    } else if (t == 0xA) {
-      if (!checkSizeHex(4, dif_vif_key, v))
-        return false;
-      if (v[2] == 'F') {
-        negate = true;
-        v[2] = '0';
-      }
-      raw = (v[2] - '0') * 10 * 10 * 10 + (v[3] - '0') * 10 * 10 +
-            (v[0] - '0') * 10 + (v[1] - '0');
-    } else if (t == 0xB) {
-      if (!checkSizeHex(6, dif_vif_key, v))
-        return false;
-      if (v[4] == 'F') {
-        negate = true;
-        v[4] = '0';
-      }
-      raw = (v[4] - '0') * 10 * 10 * 10 * 10 * 10 +
-            (v[5] - '0') * 10 * 10 * 10 * 10 + (v[2] - '0') * 10 * 10 * 10 +
-            (v[3] - '0') * 10 * 10 + (v[0] - '0') * 10 + (v[1] - '0');
-    } else if (t == 0xC) {
-      if (!checkSizeHex(8, dif_vif_key, v))
-        return false;
-      if (v[6] == 'F') {
-        negate = true;
-        v[6] = '0';
-      }
-      raw = (v[6] - '0') * 10 * 10 * 10 * 10 * 10 * 10 * 10 +
-            (v[7] - '0') * 10 * 10 * 10 * 10 * 10 * 10 +
-            (v[4] - '0') * 10 * 10 * 10 * 10 * 10 +
-            (v[5] - '0') * 10 * 10 * 10 * 10 + (v[2] - '0') * 10 * 10 * 10 +
-            (v[3] - '0') * 10 * 10 + (v[0] - '0') * 10 + (v[1] - '0');
-    } else if (t == 0xE) {
-      if (!checkSizeHex(12, dif_vif_key, v))
-        return false;
-      if (v[10] == 'F') {
-        negate = true;
-        v[10] = '0';
-      }
-      raw =
-          (v[10] - '0') * 10 * 10 * 10 * 10 * 10 * 10 * 10 * 10 * 10 * 10 * 10 +
-          (v[11] - '0') * 10 * 10 * 10 * 10 * 10 * 10 * 10 * 10 * 10 * 10 +
-          (v[8] - '0') * 10 * 10 * 10 * 10 * 10 * 10 * 10 * 10 * 10 +
-          (v[9] - '0') * 10 * 10 * 10 * 10 * 10 * 10 * 10 * 10 +
-          (v[6] - '0') * 10 * 10 * 10 * 10 * 10 * 10 * 10 +
-          (v[7] - '0') * 10 * 10 * 10 * 10 * 10 * 10 +
-          (v[4] - '0') * 10 * 10 * 10 * 10 * 10 +
-          (v[5] - '0') * 10 * 10 * 10 * 10 + (v[2] - '0') * 10 * 10 * 10 +
-          (v[3] - '0') * 10 * 10 + (v[0] - '0') * 10 + (v[1] - '0');
-    }
+    if (!checkSize(len, *this))
+      return false;
+    bool negate = false;
+    uint64_t raw = decodeBCD(v, len, &negate);
     double scale = 1.0;
     double draw = (double)raw;
     if (negate) {
@@ -1006,11 +938,8 @@ bool DVEntry::extractDouble(double *out, bool auto_scale, bool force_unsigned) {
     *out = (draw) / scale;
   } else if (t == 0x5) // 32 Bit Real
   {
-    std::vector<uchar> v;
-    hex2bin(value, &v);
-    if (!checkSizeHex(8, dif_vif_key, value))
+    if (!checkSize(4, *this))
       return false;
-    assert(v.size() == 4);
     RealConversion rc;
     rc.i = v[3] << 24 | v[2] << 16 | v[1] << 8 | v[0];
 
@@ -1047,7 +976,7 @@ bool extractDVlong(std::map<std::string, std::pair<int, DVEntry>> *dv_entries,
   std::pair<int, DVEntry> &p = (*dv_entries)[key];
   *offset = p.first;
 
-  if (p.second.value.length() == 0) {
+  if (p.second.valueLength() == 0) {
     verbose("(dvparser) warning: key found but no data  \"%s\"\n", key.c_str());
     *offset = 0;
     *out = 0;
@@ -1059,6 +988,9 @@ bool extractDVlong(std::map<std::string, std::pair<int, DVEntry>> *dv_entries,
 
 bool DVEntry::extractLong(uint64_t *out) {
   int t = dif_vif_key.dif() & 0xf;
+  const uchar *v = valueBytes();
+  size_t len = difLenBytes(dif_vif_key.dif());
+
   if (t == 0x1 || // 8 Bit Integer/Binary
       t == 0x2 || // 16 Bit Integer/Binary
       t == 0x3 || // 24 Bit Integer/Binary
@@ -1066,126 +998,22 @@ bool DVEntry::extractLong(uint64_t *out) {
       t == 0x6 || // 48 Bit Integer/Binary
       t == 0x7)   // 64 Bit Integer/Binary
   {
-    std::vector<uchar> v;
-    hex2bin(value, &v);
-    uint64_t raw = 0;
-    if (t == 0x1) {
-      if (!checkSizeHex(2, dif_vif_key, value))
-        return false;
-      assert(v.size() == 1);
-      raw = v[0];
-    } else if (t == 0x2) {
-      if (!checkSizeHex(4, dif_vif_key, value))
-        return false;
-      assert(v.size() == 2);
-      raw = v[1] * 256 + v[0];
-    } else if (t == 0x3) {
-      if (!checkSizeHex(6, dif_vif_key, value))
-        return false;
-      assert(v.size() == 3);
-      raw = v[2] * 256 * 256 + v[1] * 256 + v[0];
-    } else if (t == 0x4) {
-      if (!checkSizeHex(8, dif_vif_key, value))
-        return false;
-      assert(v.size() == 4);
-      raw = ((unsigned int)v[3]) * 256 * 256 * 256 +
-            ((unsigned int)v[2]) * 256 * 256 + ((unsigned int)v[1]) * 256 +
-            ((unsigned int)v[0]);
-    } else if (t == 0x6) {
-      if (!checkSizeHex(12, dif_vif_key, value))
-        return false;
-      assert(v.size() == 6);
-      raw = ((uint64_t)v[5]) * 256 * 256 * 256 * 256 * 256 +
-            ((uint64_t)v[4]) * 256 * 256 * 256 * 256 +
-            ((uint64_t)v[3]) * 256 * 256 * 256 + ((uint64_t)v[2]) * 256 * 256 +
-            ((uint64_t)v[1]) * 256 + ((uint64_t)v[0]);
-    } else if (t == 0x7) {
-      if (!checkSizeHex(16, dif_vif_key, value))
-        return false;
-      assert(v.size() == 8);
-      raw = ((uint64_t)v[7]) * 256 * 256 * 256 * 256 * 256 * 256 * 256 +
-            ((uint64_t)v[6]) * 256 * 256 * 256 * 256 * 256 * 256 +
-            ((uint64_t)v[5]) * 256 * 256 * 256 * 256 * 256 +
-            ((uint64_t)v[4]) * 256 * 256 * 256 * 256 +
-            ((uint64_t)v[3]) * 256 * 256 * 256 + ((uint64_t)v[2]) * 256 * 256 +
-            ((uint64_t)v[1]) * 256 + ((uint64_t)v[0]);
-    }
-    *out = raw;
+    if (!checkSize(len, *this))
+      return false;
+    *out = decodeBinary(v, len);
   } else if (t == 0x9 || // 2 digit BCD
              t == 0xA || // 4 digit BCD
              t == 0xB || // 6 digit BCD
              t == 0xC || // 8 digit BCD
              t == 0xE)   // 12 digit BCD
   {
-    // 74140000 -> 00001474
-    std::string &v = value;
-    if (is_all_F(v)) {
+    if (isAllFF(v, valueLength())) {
       return false;
     }
-    uint64_t raw = 0;
+    if (!checkSize(len, *this))
+      return false;
     bool negate = false;
-    if (t == 0x9) {
-      if (!checkSizeHex(2, dif_vif_key, value))
-        return false;
-      if (v[0] == 'F') {
-        negate = true;
-        v[0] = '0';
-      }
-      assert(v.size() == 2);
-      raw = (v[0] - '0') * 10 + (v[1] - '0');
-    } else if (t == 0xA) {
-      if (!checkSizeHex(4, dif_vif_key, value))
-        return false;
-      if (v[2] == 'F') {
-        negate = true;
-        v[2] = '0';
-      }
-      assert(v.size() == 4);
-      raw = (v[2] - '0') * 10 * 10 * 10 + (v[3] - '0') * 10 * 10 +
-            (v[0] - '0') * 10 + (v[1] - '0');
-    } else if (t == 0xB) {
-      if (!checkSizeHex(6, dif_vif_key, value))
-        return false;
-      if (v[4] == 'F') {
-        negate = true;
-        v[4] = '0';
-      }
-      assert(v.size() == 6);
-      raw = (v[4] - '0') * 10 * 10 * 10 * 10 * 10 +
-            (v[5] - '0') * 10 * 10 * 10 * 10 + (v[2] - '0') * 10 * 10 * 10 +
-            (v[3] - '0') * 10 * 10 + (v[0] - '0') * 10 + (v[1] - '0');
-    } else if (t == 0xC) {
-      if (!checkSizeHex(8, dif_vif_key, value))
-        return false;
-      if (v[6] == 'F') {
-        negate = true;
-        v[6] = '0';
-      }
-      assert(v.size() == 8);
-      raw = (v[6] - '0') * 10 * 10 * 10 * 10 * 10 * 10 * 10 +
-            (v[7] - '0') * 10 * 10 * 10 * 10 * 10 * 10 +
-            (v[4] - '0') * 10 * 10 * 10 * 10 * 10 +
-            (v[5] - '0') * 10 * 10 * 10 * 10 + (v[2] - '0') * 10 * 10 * 10 +
-            (v[3] - '0') * 10 * 10 + (v[0] - '0') * 10 + (v[1] - '0');
-    } else if (t == 0xE) {
-      if (!checkSizeHex(12, dif_vif_key, value))
-        return false;
-      if (v[10] == 'F') {
-        negate = true;
-        v[10] = '0';
-      }
-      assert(v.size() == 12);
-      raw =
-          (v[10] - '0') * 10 * 10 * 10 * 10 * 10 * 10 * 10 * 10 * 10 * 10 * 10 +
-          (v[11] - '0') * 10 * 10 * 10 * 10 * 10 * 10 * 10 * 10 * 10 * 10 +
-          (v[8] - '0') * 10 * 10 * 10 * 10 * 10 * 10 * 10 * 10 * 10 +
-          (v[9] - '0') * 10 * 10 * 10 * 10 * 10 * 10 * 10 * 10 +
-          (v[6] - '0') * 10 * 10 * 10 * 10 * 10 * 10 * 10 +
-          (v[7] - '0') * 10 * 10 * 10 * 10 * 10 * 10 +
-          (v[4] - '0') * 10 * 10 * 10 * 10 * 10 +
-          (v[5] - '0') * 10 * 10 * 10 * 10 + (v[2] - '0') * 10 * 10 * 10 +
-          (v[3] - '0') * 10 * 10 + (v[0] - '0') * 10 + (v[1] - '0');
-    }
+    uint64_t raw = decodeBCD(v, len, &negate);
 
     if (negate) {
       raw = (uint64_t)(((int64_t)raw) * -1);
@@ -1212,7 +1040,7 @@ bool extractDVHexString(
   }
   std::pair<int, DVEntry> &p = (*dv_entries)[key];
   *offset = p.first;
-  *value = p.second.value;
+  *value = p.second.value();
 
   return true;
 }
@@ -1236,7 +1064,7 @@ bool extractDVReadableString(
 bool DVEntry::extractReadableString(std::string *out) {
   int t = dif_vif_key.dif() & 0xf;
 
-  std::string v = value;
+  std::string v = value();
 
   if (t == 0x1 || // 8 Bit Integer/Binary
       t == 0x2 || // 16 Bit Integer/Binary
@@ -1285,6 +1113,18 @@ double DVEntry::getCounter(DVEntryCounterType ct) {
   return std::numeric_limits<double>::quiet_NaN();
 }
 
+std::string DVEntry::value() const {
+  static const char hex[] = "0123456789ABCDEF";
+  std::string s;
+  s.reserve(value_len_ * 2);
+  const uchar *v = valueBytes();
+  for (size_t i = 0; i < value_len_; ++i) {
+    s.push_back(hex[v[i] >> 4]);
+    s.push_back(hex[v[i] & 0x0f]);
+  }
+  return s;
+}
+
 std::string DVEntry::str() {
   std::string s = tostrprintf(
       "%d: %s %s vif=%x %s%s st=%d ta=%d su=%d", offset,
@@ -1351,16 +1191,16 @@ bool DVEntry::extractDate(struct tm *out) {
   memset(out, 0, sizeof(*out));
   out->tm_isdst = -1; // Figure out the dst automatically!
 
-  std::vector<uchar> v;
-  hex2bin(value, &v);
+  const uchar *v = valueBytes();
+  size_t len = valueLength();
 
   bool ok = true;
-  if (v.size() == 2) {
+  if (len == 2) {
     ok &= ::extractDate(v[1], v[0], out);
-  } else if (v.size() == 4) {
+  } else if (len == 4) {
     ok &= ::extractDate(v[3], v[2], out);
     ok &= ::extractTime(v[1], v[0], out);
-  } else if (v.size() == 6) {
+  } else if (len == 6) {
     ok &= ::extractDate(v[4], v[3], out);
     ok &= ::extractTime(v[2], v[1], out);
     // ..ss ssss
@@ -230,7 +230,7 @@ struct DifVifKey {
   DifVifKey(std::string key) : key_(key) {
     extractDV(key, &dif_, &vif_, &has_difes_, &has_vifes_);
   }
-  std::string str() { return key_; }
+  const std::string &str() { return key_; }
   bool operator==(DifVifKey &dvk) { return key_ == dvk.key_; }
   uchar dif() { return dif_; }
   int vif() { return vif_; }
@@ -335,19 +335,41 @@ struct DVEntry {
   StorageNr storage_nr;
   TariffNr tariff_nr;
   SubUnitNr subunit_nr;
-  std::string value;
 
   DVEntry(int off, DifVifKey dvk, MeasurementType mt, Vif vi,
           std::set<VIFCombinable> vc, std::set<uint16_t> vc_raw, StorageNr st,
-          TariffNr ta, SubUnitNr su, std::string &val)
+          TariffNr ta, SubUnitNr su, const std::vector<uchar> &frame,
+          size_t value_offset, size_t value_len)
       : offset(off), dif_vif_key(dvk), measurement_type(mt), vif(vi),
         combinable_vifs(vc), combinable_vifs_raw(vc_raw), storage_nr(st),
-        tariff_nr(ta), subunit_nr(su), value(val) {}
+        tariff_nr(ta), subunit_nr(su), frame_(&frame),
+        value_offset_(value_offset), value_len_(value_len) {}
+
+  // Used by drivers that synthesize entries from a hex string.
+  DVEntry(int off, DifVifKey dvk, MeasurementType mt, Vif vi,
+          std::set<VIFCombinable> vc, std::set<uint16_t> vc_raw, StorageNr st,
+          TariffNr ta, SubUnitNr su, const std::string &val)
+      : offset(off), dif_vif_key(dvk), measurement_type(mt), vif(vi),
+        combinable_vifs(vc), combinable_vifs_raw(vc_raw), storage_nr(st),
+        tariff_nr(ta), subunit_nr(su) {
+    hex2bin(val, &owned_value_);
+    value_len_ = owned_value_.size();
+  }
 
   DVEntry()
       : offset(999999), dif_vif_key("????"),
         measurement_type(MeasurementType::Instantaneous), vif(0), storage_nr(0),
-        tariff_nr(0), subunit_nr(0), value("x") {}
+        tariff_nr(0), subunit_nr(0) {}
+
+  // The raw value bytes, either a view into the frame the entry was parsed
+  // from or the bytes owned by a synthesized entry.
+  const uchar *valueBytes() const {
+    return frame_ != NULL ? frame_->data() + value_offset_
+                          : owned_value_.data();
+  }
+  size_t valueLength() const { return value_len_; }
+  // The value rendered as a hex string, only intended for logging.
+  std::string value() const;
 
   bool extractDouble(double *out, bool auto_scale, bool force_unsigned);
   bool extractLong(uint64_t *out);
@@ -362,6 +384,10 @@ struct DVEntry {
 private:
   std::set<FieldInfo *>
       field_infos_; // The field infos selected to decode this entry.
+  const std::vector<uchar> *frame_{}; // Frame holding the value, if parsed.
+  size_t value_offset_{};
+  size_t value_len_{};
+  std::vector<uchar> owned_value_;
 };
 
 struct FieldMatcher {
@@ -36,126 +36,211 @@ NumericFormulaDivision::~NumericFormulaDivision() {}
 NumericFormulaExponentiation::~NumericFormulaExponentiation() {}
 NumericFormulaSquareRoot::~NumericFormulaSquareRoot() {}
 
-double NumericFormulaConstant::calculate(SIUnit to) {
-  double r{};
-  siunit().convertTo(constant_, to, &r);
-  return r;
-}
-
-double NumericFormulaMeterField::calculate(SIUnit to_si_unit) {
-  if (formula()->meter() == NULL)
-    return std::numeric_limits<double>::quiet_NaN();
-
-  FieldInfo *fi = formula()->meter()->findFieldInfo(vname_, quantity_);
-
-  Unit field_unit = fi->displayUnit();
-  double val = formula()->meter()->getNumericValue(fi, field_unit);
-
-  const SIUnit &field_si_unit = toSIUnit(field_unit);
-
-  double r{};
-  field_si_unit.convertTo(val, to_si_unit, &r);
-  return r;
-}
-
-double NumericFormulaDVEntryField::calculate(SIUnit to_si_unit) {
-  if (formula()->dventry() == NULL)
-    return std::numeric_limits<double>::quiet_NaN();
-
-  double val = formula()->dventry()->getCounter(counter_);
-
-  const SIUnit &counter_si_unit = toSIUnit(Unit::COUNTER);
-
-  double r{};
-  counter_si_unit.convertTo(val, to_si_unit, &r);
-  return r;
+static double runBinaryOp(const FormulaOp &op, double left, double right) {
+  double l = left * op.scale + op.offset;
+  double r = right * op.right_scale + op.right_offset;
+  if (op.swap)
+    std::swap(l, r);
+  switch (op.code) {
+  case FormulaOpCode::ADD:
+    return l + r;
+  case FormulaOpCode::SUB:
+    return l - r;
+  case FormulaOpCode::ADD_MONTHS:
+    return addMonths(l, r);
+  case FormulaOpCode::SUB_MONTHS:
+    return addMonths(l, -r);
+  case FormulaOpCode::MUL:
+    return l * r;
+  case FormulaOpCode::DIV:
+    return l / r;
+  default:
+    break;
+  }
+  return std::numeric_limits<double>::quiet_NaN();
 }
 
-double NumericFormulaAddition::calculate(SIUnit to_siunit) {
-  double l = left_->calculate(left_->siunit());
-  double r = right_->calculate(right_->siunit());
+double FormulaImplementation::run() {
+  std::vector<FieldInfo> *fields = NULL;
+  double *sp = stack_.data();
 
-  double v{};
-  SIUnit v_siunit(Unit::COUNTER);
-  left_->siunit().mathOpTo(MathOp::ADD, l, r, right_->siunit(), &v_siunit, &v);
-
-  double result{};
-  v_siunit.convertTo(v, to_siunit, &result);
+  for (const FormulaOp &op : program_) {
+    switch (op.code) {
+    case FormulaOpCode::CONST:
+      *sp++ = op.value;
+      continue;
+    case FormulaOpCode::FIELD: {
+      double v = std::numeric_limits<double>::quiet_NaN();
+      if (meter_ != NULL) {
+        if (fields == NULL)
+          fields = &meter_->fieldInfos();
+        // Meters of the same driver share the layout of the field infos.
+        if (op.index < fields->size()) {
+          FieldInfo *fi = &(*fields)[op.index];
+          v = meter_->getNumericValue(fi, fi->displayUnit());
+        }
+      }
+      *sp++ = v * op.scale + op.offset;
+      continue;
+    }
+    case FormulaOpCode::DVENTRY:
+      *sp++ = dventry_ == NULL ? std::numeric_limits<double>::quiet_NaN()
+                               : dventry_->getCounter(
+                                     (DVEntryCounterType)op.index);
+      continue;
+    case FormulaOpCode::SQRT:
+      sp[-1] = sqrt(sp[-1]);
+      continue;
+    default:
+      break;
+    }
 
-  debug("(formula) ADD %g (%s) %g (%s) --> %g %s --> %g %s\n", l,
-        left_->siunit().info().c_str(), r, right_->siunit().info().c_str(), v,
-        v_siunit.info().c_str(), result, siunit().info().c_str());
+    // The remaining ops are binary.
+    sp--;
+    sp[-1] = runBinaryOp(op, sp[-1], sp[0]);
+  }
 
-  return result;
+  return stack_[0];
 }
 
-double NumericFormulaSubtraction::calculate(SIUnit to_siunit) {
-  double l = left_->calculate(left_->siunit());
-  double r = right_->calculate(right_->siunit());
-
-  double v{};
-  SIUnit v_siunit(Unit::COUNTER);
-  left_->siunit().mathOpTo(MathOp::SUB, l, r, right_->siunit(), &v_siunit, &v);
+// A folded operand is either a constant b, or a meter field v read as
+// v*a+b.
+struct FoldedOperand {
+  bool field;
+  double a;
+  double b;
+};
 
-  double result{};
-  v_siunit.convertTo(v, to_siunit, &result);
-
-  debug("(formula) SUB %g (%s) %g (%s) --> %g %s --> %g %s\n", l,
-        left_->siunit().info().c_str(), r, right_->siunit().info().c_str(), v,
-        v_siunit.info().c_str(), result, siunit().info().c_str());
-
-  return result;
+static bool isBinary(FormulaOpCode code) {
+  return code != FormulaOpCode::CONST && code != FormulaOpCode::FIELD &&
+         code != FormulaOpCode::DVENTRY && code != FormulaOpCode::SQRT;
 }
 
-double NumericFormulaMultiplication::calculate(SIUnit to_siunit) {
-  double l = left_->calculate(left_->siunit());
-  double r = right_->calculate(right_->siunit());
-  double m = l * r;
-  double v{};
-  siunit().convertTo(m, to_siunit, &v);
-
-  debug("(formula) MUL %g (%s) %g (%s) --> %g --> %g %s\n", l,
-        left_->siunit().info().c_str(), r, right_->siunit().info().c_str(), m,
-        v, to_siunit.info().c_str());
+// Fold a binary op whose operands are a field and a constant into the field
+// read. Return false if the result is not an affine function of the field.
+static bool foldFieldOp(FormulaOp *left, FormulaOp *right,
+                        const FormulaOp &op) {
+  FoldedOperand l{left->code == FormulaOpCode::FIELD, 0.0, 0.0};
+  FoldedOperand r{right->code == FormulaOpCode::FIELD, 0.0, 0.0};
+  if (l.field) {
+    l.a = left->scale * op.scale;
+    l.b = left->offset * op.scale + op.offset;
+  } else {
+    l.b = left->value * op.scale + op.offset;
+  }
+  if (r.field) {
+    r.a = right->scale * op.right_scale;
+    r.b = right->offset * op.right_scale + op.right_offset;
+  } else {
+    r.b = right->value * op.right_scale + op.right_offset;
+  }
+  if (op.swap)
+    std::swap(l, r);
+
+  FoldedOperand v{true, 0.0, 0.0};
+  switch (op.code) {
+  case FormulaOpCode::ADD:
+    v.a = l.a + r.a;
+    v.b = l.b + r.b;
+    break;
+  case FormulaOpCode::SUB:
+    v.a = l.a - r.a;
+    v.b = l.b - r.b;
+    break;
+  case FormulaOpCode::MUL:
+    if (l.field) {
+      v.a = l.a * r.b;
+      v.b = l.b * r.b;
+    } else {
+      v.a = r.a * l.b;
+      v.b = r.b * l.b;
+    }
+    break;
+  case FormulaOpCode::DIV:
+    if (!l.field)
+      return false;
+    v.a = l.a / r.b;
+    v.b = l.b / r.b;
+    break;
+  default:
+    return false;
+  }
 
-  return v;
+  FormulaOp *field = left->code == FormulaOpCode::FIELD ? left : right;
+  left->code = FormulaOpCode::FIELD;
+  left->index = field->index;
+  left->scale = v.a;
+  left->offset = v.b;
+  return true;
 }
 
-double NumericFormulaDivision::calculate(SIUnit to_siunit) {
-  double l = left_->calculate(left_->siunit());
-  double r = right_->calculate(right_->siunit());
-  double d = l / r;
-  double v{};
-  siunit().convertTo(d, to_siunit, &v);
+void FormulaImplementation::foldConstants() {
+  std::vector<FormulaOp> folded;
+  size_t depth = 0;
+  size_t max_depth = 0;
 
-  debug("(formula) DIV %g (%s) %g (%s) --> %g --> %g %s\n", l,
-        left_->siunit().info().c_str(), r, right_->siunit().info().c_str(), d,
-        v, to_siunit.info().c_str());
+  for (const FormulaOp &op : program_) {
+    size_t n = folded.size();
+    if (op.code == FormulaOpCode::SQRT &&
+        folded[n - 1].code == FormulaOpCode::CONST) {
+      folded[n - 1].value = sqrt(folded[n - 1].value);
+      continue;
+    }
+    if (isBinary(op.code)) {
+      FormulaOp *left = &folded[n - 2];
+      FormulaOp *right = &folded[n - 1];
+      bool left_const = left->code == FormulaOpCode::CONST;
+      bool right_const = right->code == FormulaOpCode::CONST;
+      bool left_field = left->code == FormulaOpCode::FIELD;
+      bool right_field = right->code == FormulaOpCode::FIELD;
+      if (left_const && right_const) {
+        left->value = runBinaryOp(op, left->value, right->value);
+        folded.pop_back();
+        depth--;
+        continue;
+      }
+      if (((left_field && right_const) || (left_const && right_field)) &&
+          foldFieldOp(left, right, op)) {
+        folded.pop_back();
+        depth--;
+        continue;
+      }
+    }
 
-  return v;
-}
+    folded.push_back(op);
+    if (isBinary(op.code))
+      depth--;
+    else if (op.code != FormulaOpCode::SQRT)
+      depth++;
+    if (depth > max_depth)
+      max_depth = depth;
+  }
 
-double NumericFormulaExponentiation::calculate(SIUnit to_siunit) {
-  double l = left_->calculate(to_siunit);
-  double r = right_->calculate(to_siunit);
-  double p = pow(l, r);
-  double v{};
-  siunit().convertTo(p, to_siunit, &v);
+  debug("(formula) folded program from %zu to %zu ops\n", program_.size(),
+        folded.size());
 
-  debug("(formula) %g <-- %g <-- pow %g ^ %g\n", v, p, l, r);
-  return v;
+  program_.swap(folded);
+  stack_.resize(max_depth);
 }
 
-double NumericFormulaSquareRoot::calculate(SIUnit to_siunit) {
-  double i = inner_->calculate(inner_->siunit());
-  double s = sqrt(i);
-  double v{};
-  siunit().convertTo(s, to_siunit, &v);
-
-  debug("(formula) SQRT %g (%s) --> %g --> %g %s\n", i,
-        inner_->siunit().info().c_str(), s, v, to_siunit.info().c_str());
+FormulaOp &FormulaImplementation::emitOp(FormulaOpCode code) {
+  switch (code) {
+  case FormulaOpCode::CONST:
+  case FormulaOpCode::FIELD:
+  case FormulaOpCode::DVENTRY:
+    depth_++;
+    if (depth_ > stack_.size())
+      stack_.resize(depth_);
+    break;
+  case FormulaOpCode::SQRT:
+    break;
+  default:
+    depth_--;
+    break;
+  }
 
-  return v;
+  program_.push_back(FormulaOp{code, false, 0, 0.0, 1.0, 0.0, 1.0, 0.0});
+  return program_.back();
 }
 
 const char *toString(TokenType tt) {
@@ -232,6 +317,10 @@ Unit Token::unit(const std::string &s) {
 void FormulaImplementation::clear() {
   valid_ = true;
   op_stack_.clear();
+  program_.clear();
+  stack_.clear();
+  depth_ = 0;
+  to_cached_ = false;
   tokens_.clear();
   formula_ = "";
   dventry_ = NULL;
@@ -895,6 +984,9 @@ bool FormulaImplementation::parse(Meter *m, const std::string &f) {
 
   debug("(formula) %s\n", tree().c_str());
 
+  if (valid())
+    foldConstants();
+
   return valid_;
 }
 
@@ -929,16 +1021,55 @@ double FormulaImplementation::calculate(Unit to, DVEntry *dve, Meter *m) {
     return std::nan("");
   }
 
-  return topOp()->calculate(toSIUnit(to));
+  if (!to_cached_ || to_unit_ != to) {
+    siUnit().affineTo(toSIUnit(to), &to_scale_, &to_offset_);
+    to_unit_ = to;
+    to_cached_ = true;
+  }
+
+  return run() * to_scale_ + to_offset_;
 }
 
 void FormulaImplementation::doConstant(Unit u, double c) {
+  emitOp(FormulaOpCode::CONST).value = c;
+
   pushOp(new NumericFormulaConstant(this, u, c));
 }
 
+// Emit the add or sub op, with the conversions that SIUnit::mathOpTo does for
+// the operand units.
+static void emitMathOp(FormulaOp &op, MathOp mop, const SIUnit &left_siunit,
+                       const SIUnit &right_siunit) {
+  const SIExp &ts = SI_UnixTimestamp.exp();
+
+  if (left_siunit.exp() != right_siunit.exp() &&
+      (left_siunit.exp() == ts || right_siunit.exp() == ts)) {
+    // Operating on a unix timestamp, mathOpTo puts the timestamp first.
+    op.swap = right_siunit.exp() == ts;
+    const SIUnit &other = op.swap ? left_siunit : right_siunit;
+    if (other.exp() == SI_Month.exp()) {
+      op.code = mop == MathOp::ADD ? FormulaOpCode::ADD_MONTHS
+                                   : FormulaOpCode::SUB_MONTHS;
+      return;
+    }
+    // Move the other argument (day, hour, min, s) to seconds.
+    if (op.swap)
+      left_siunit.affineTo(SI_Second, &op.scale, &op.offset);
+    else
+      right_siunit.affineTo(SI_Second, &op.right_scale, &op.right_offset);
+    return;
+  }
+
+  // The left argument is converted into the unit of the right argument.
+  left_siunit.affineTo(right_siunit, &op.scale, &op.offset);
+}
+
 void FormulaImplementation::doAddition(const SIUnit &to_siunit) {
   assert(op_stack_.size() >= 2);
 
+  emitMathOp(emitOp(FormulaOpCode::ADD), MathOp::ADD, top2Op()->siunit(),
+             topOp()->siunit());
+
   std::unique_ptr<NumericFormula> right_node = popOp();
   std::unique_ptr<NumericFormula> left_node = popOp();
 
@@ -948,6 +1079,9 @@ void FormulaImplementation::doAddition(const SIUnit &to_siunit) {
 void FormulaImplementation::doSubtraction(const SIUnit &to_siunit) {
   assert(op_stack_.size() >= 2);
 
+  emitMathOp(emitOp(FormulaOpCode::SUB), MathOp::SUB, top2Op()->siunit(),
+             topOp()->siunit());
+
   std::unique_ptr<NumericFormula> right_node = popOp();
   std::unique_ptr<NumericFormula> left_node = popOp();
 
@@ -957,6 +1091,8 @@ void FormulaImplementation::doSubtraction(const SIUnit &to_siunit) {
 void FormulaImplementation::doMultiplication() {
   assert(op_stack_.size() >= 2);
 
+  emitOp(FormulaOpCode::MUL);
+
   SIUnit right_siunit = topOp()->siunit();
 
   std::unique_ptr<NumericFormula> right_node = popOp();
@@ -978,6 +1114,8 @@ void FormulaImplementation::doMultiplication() {
 void FormulaImplementation::doDivision() {
   assert(op_stack_.size() >= 2);
 
+  emitOp(FormulaOpCode::DIV);
+
   SIUnit right_siunit = topOp()->siunit();
 
   std::unique_ptr<NumericFormula> right_node = popOp();
@@ -1001,6 +1139,8 @@ void FormulaImplementation::doDivision() {
 void FormulaImplementation::doExponentiation() {
   assert(op_stack_.size() >= 2);
 
+  emitOp(FormulaOpCode::DIV);
+
   //    SIUnit right_siunit = topOp()->siunit();
 
   std::unique_ptr<NumericFormula> right_node = popOp();
@@ -1021,6 +1161,8 @@ void FormulaImplementation::doSquareRoot() {
 
   SIUnit siunit = inner_siunit.sqrt();
 
+  emitOp(FormulaOpCode::SQRT);
+
   std::unique_ptr<NumericFormula> inner_node = popOp();
 
   pushOp(new NumericFormulaSquareRoot(this, siunit, inner_node));
@@ -1031,10 +1173,16 @@ void FormulaImplementation::doMeterField(Unit u, FieldInfo *fi) {
   SIUnit to_si_unit = toSIUnit(u);
   assert(from_si_unit.convertTo(0, to_si_unit, NULL));
 
+  FormulaOp &op = emitOp(FormulaOpCode::FIELD);
+  op.index = fi - meter_->fieldInfos().data();
+  from_si_unit.affineTo(to_si_unit, &op.scale, &op.offset);
+
   pushOp(new NumericFormulaMeterField(this, u, fi->vname(), fi->xuantity()));
 }
 
 void FormulaImplementation::doDVEntryField(Unit u, DVEntryCounterType ct) {
+  emitOp(FormulaOpCode::DVENTRY).index = (size_t)ct;
+
   pushOp(new NumericFormulaDVEntryField(this, Unit::COUNTER, ct));
 }
 
@@ -1165,6 +1313,7 @@ StringInterpolatorImplementation::~StringInterpolatorImplementation() {}
 bool StringInterpolatorImplementation::parse(Meter *m, const std::string &f) {
   strings_.clear();
   formulas_.clear();
+  point_in_time_.clear();
 
   size_t prev_string_start = 0;
   size_t next_start_brace = f.find('{', prev_string_start);
@@ -1187,6 +1336,8 @@ bool StringInterpolatorImplementation::parse(Meter *m, const std::string &f) {
     bool ok = formulas_.back()->parse(m, formula);
     if (!ok)
       return false;
+    Unit u = formulas_.back()->siUnit().asUnit(Quantity::PointInTime);
+    point_in_time_.push_back(u == Unit::UnixTimestamp);
 
     prev_string_start = next_end_brace + 1;
 
@@ -1219,8 +1370,7 @@ std::string StringInterpolatorImplementation::apply(Meter *m, DVEntry *dve) {
     if (f < formulas_.size()) {
       Formula *ff = formulas_[f].get();
       if (dve != NULL) {
-        Unit u = ff->siUnit().asUnit(Quantity::PointInTime);
-        if (u == Unit::UnixTimestamp) {
+        if (point_in_time_[f]) {
           double pt = ff->calculate(Unit::UnixTimestamp, dve, m);
           // Print as DateLT
           result += strdate(pt);
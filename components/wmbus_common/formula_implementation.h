@@ -29,8 +29,6 @@ struct NumericFormula {
   NumericFormula(FormulaImplementation *f, SIUnit u)
       : formula_(f), siunit_(u) {}
   SIUnit &siunit() { return siunit_; }
-  // Calculate the formula and return the value in the given "to" unit.
-  virtual double calculate(SIUnit to) = 0;
   virtual std::string str() = 0;
   virtual std::string tree() = 0;
   virtual ~NumericFormula() = 0;
@@ -45,7 +43,6 @@ private:
 struct NumericFormulaConstant : public NumericFormula {
   NumericFormulaConstant(FormulaImplementation *f, Unit u, double c)
       : NumericFormula(f, u), constant_(c) {}
-  double calculate(SIUnit to);
   std::string str();
   std::string tree();
   ~NumericFormulaConstant();
@@ -59,7 +56,6 @@ struct NumericFormulaMeterField : public NumericFormula {
                            Quantity q)
       : NumericFormula(f, u), vname_(v), quantity_(q) {}
 
-  double calculate(SIUnit to);
   std::string str();
   std::string tree();
   ~NumericFormulaMeterField();
@@ -74,7 +70,6 @@ struct NumericFormulaDVEntryField : public NumericFormula {
                              DVEntryCounterType ct)
       : NumericFormula(f, u), counter_(ct) {}
 
-  double calculate(SIUnit to);
   std::string str();
   std::string tree();
   ~NumericFormulaDVEntryField();
@@ -108,8 +103,6 @@ struct NumericFormulaAddition : public NumericFormulaPair {
                          std::unique_ptr<NumericFormula> &b)
       : NumericFormulaPair(f, siu, a, b, "ADD", "+") {}
 
-  double calculate(SIUnit to);
-
   ~NumericFormulaAddition();
 };
 
@@ -119,8 +112,6 @@ struct NumericFormulaSubtraction : public NumericFormulaPair {
                             std::unique_ptr<NumericFormula> &b)
       : NumericFormulaPair(f, siu, a, b, "SUB", "-") {}
 
-  double calculate(SIUnit to);
-
   ~NumericFormulaSubtraction();
 };
 
@@ -130,8 +121,6 @@ struct NumericFormulaMultiplication : public NumericFormulaPair {
                                std::unique_ptr<NumericFormula> &b)
       : NumericFormulaPair(f, siu, a, b, "TIMES", "×") {}
 
-  double calculate(SIUnit to);
-
   ~NumericFormulaMultiplication();
 };
 
@@ -141,8 +130,6 @@ struct NumericFormulaDivision : public NumericFormulaPair {
                          std::unique_ptr<NumericFormula> &b)
       : NumericFormulaPair(f, siu, a, b, "DIV", "÷") {}
 
-  double calculate(SIUnit to);
-
   ~NumericFormulaDivision();
 };
 
@@ -152,8 +139,6 @@ struct NumericFormulaExponentiation : public NumericFormulaPair {
                                std::unique_ptr<NumericFormula> &b)
       : NumericFormulaPair(f, siu, a, b, "EXP", "^") {}
 
-  double calculate(SIUnit to);
-
   ~NumericFormulaExponentiation();
 };
 
@@ -162,7 +147,6 @@ struct NumericFormulaSquareRoot : public NumericFormula {
                            std::unique_ptr<NumericFormula> &inner)
       : NumericFormula(f, siu), inner_(std::move(inner)) {}
 
-  double calculate(SIUnit to);
   std::string str();
   std::string tree();
 
@@ -172,6 +156,41 @@ private:
   std::unique_ptr<NumericFormula> inner_;
 };
 
+// The parsed formula is also compiled into a program for a small stack
+// machine, stored in reverse polish order. Meter fields are referenced by
+// their position in the meter's field infos and every unit conversion is
+// reduced to a scale and an offset, so running the program does not look up
+// names, compare strings or allocate.
+enum class FormulaOpCode {
+  CONST,      // Push value.
+  FIELD,      // Push the meter field at index, converted with scale/offset.
+  DVENTRY,    // Push the dventry counter with type index.
+  ADD,        // Pop two operands, convert them and push the sum.
+  SUB,        // Pop two operands, convert them and push the difference.
+  ADD_MONTHS, // Pop a unix timestamp and a number of months, push the sum.
+  SUB_MONTHS, // Pop a unix timestamp and a number of months, push the
+              // difference.
+  MUL,
+  DIV,
+  SQRT
+};
+
+struct FormulaOp {
+  FormulaOpCode code;
+  // Binary ops: use the right operand as the first argument.
+  bool swap;
+  // FIELD: position in fieldInfos(). DVENTRY: the DVEntryCounterType.
+  size_t index;
+  // CONST: the constant.
+  double value;
+  // FIELD: from the field display unit. Binary ops: the left operand.
+  double scale;
+  double offset;
+  // Binary ops: the right operand.
+  double right_scale;
+  double right_offset;
+};
+
 enum class TokenType {
   SPACE,
   LPAR,
@@ -282,6 +301,14 @@ struct FormulaImplementation : public Formula {
   void handleSquareRoot(Token *add);
   void handleField(Token *field);
 
+  // Append an op to the compiled program and track the needed stack depth.
+  FormulaOp &emitOp(FormulaOpCode code);
+  // Replace the ops that only depend on constants with their result and
+  // merge constant factors and terms into the meter field reads.
+  void foldConstants();
+  // Run the compiled program, the result is in the unit of the top node.
+  double run();
+
   void pushOp(NumericFormula *nf);
   std::unique_ptr<NumericFormula> popOp();
   NumericFormula *topOp();
@@ -298,6 +325,15 @@ private:
   Meter *meter_;        // To be referenced when parsing and calculating.
   DVEntry *dventry_;    // To be referenced when calculating.
 
+  std::vector<FormulaOp> program_;
+  std::vector<double> stack_; // Sized for the program when parsing.
+  size_t depth_ = 0;
+  // The conversion of the result into the last requested unit.
+  bool to_cached_ = false;
+  Unit to_unit_ = Unit::Unknown;
+  double to_scale_ = 1.0;
+  double to_offset_ = 0.0;
+
   // Any errors during parsing are store here.
   std::vector<std::string> errors_;
 };
@@ -314,6 +350,8 @@ struct StringInterpolatorImplementation : public StringInterpolator {
   std::vector<std::string> strings_;
   // The formula stores the parsed "storage_counter / - 12 counter" formula.
   std::vector<std::unique_ptr<Formula>> formulas_;
+  // True if the formula with the same index calculates a point in time.
+  std::vector<bool> point_in_time_;
 };
 
 #endif
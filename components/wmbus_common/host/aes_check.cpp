@@ -0,0 +1,240 @@
+// Known answer check of the AES backends for ECB, CBC, CTR and CMAC.
+//
+// Both backends are compiled into this program, each in its own namespace,
+// checked against published vectors and two driver test telegrams, and then
+// compared with each other on random keys and lengths. Build and run from
+// components/wmbus_common with the mbedTLS development files installed:
+//
+//   g++ -std=c++17 -O2 -Ihost -I. host/aes_check.cpp util.cpp -lmbedcrypto
+//   ./a.out
+
+// Everything the backend sources include, so that including them inside a
+// namespace below does not pull system headers into it.
+#include "mbedtls/aes.h"
+#include "util.h"
+#include <memory.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace software {
+#include "aes.cpp"
+#include "aescmac.cpp"
+} // namespace software
+
+#undef _AES_H_
+#undef _AESCMAC_H_
+#define WMBUS_AES_MBEDTLS
+
+namespace mbedtls_backend {
+#include "aes.cpp"
+#include "aes_mbedtls.cpp"
+#include "aescmac.cpp"
+} // namespace mbedtls_backend
+
+static int failures = 0;
+
+static std::vector<uchar> hex(const char *s) {
+  std::vector<uchar> v;
+  hex2bin(s, &v);
+  return v;
+}
+
+static void expect(const char *backend, const char *what,
+                   const std::vector<uchar> &got,
+                   const std::vector<uchar> &want) {
+  if (got == want)
+    return;
+  failures++;
+  printf("FAIL %s %s\n  got  %s\n  want %s\n", backend, what,
+         bin2hex(got).c_str(), bin2hex(want).c_str());
+}
+
+static const char *KEY = "2b7e151628aed2a6abf7158809cf4f3c";
+static const char *PLAIN = "6bc1bee22e409f96e93d7e117393172a"
+                           "ae2d8a571e03ac9c9eb76fac45af8e51"
+                           "30c81c46a35ce411e5fbc1191a0a52ef"
+                           "f69f2445df4f9b17ad2b417be66c3710";
+
+// Runs the same operations on one backend. Instantiated once per namespace.
+#define BACKEND_FUNCTIONS(ns)                                                  \
+  namespace ns {                                                               \
+  static std::vector<uchar> ecb(const std::vector<uchar> &key,                 \
+                                const std::vector<uchar> &in, bool enc) {      \
+    std::vector<uchar> out(in.size());                                         \
+    if (enc)                                                                   \
+      AES_ECB_encrypt(in.data(), key.data(), out.data(), in.size());           \
+    else                                                                       \
+      AES_ECB_decrypt(in.data(), key.data(), out.data(), in.size());           \
+    return out;                                                                \
+  }                                                                            \
+  static std::vector<uchar> cbc(const std::vector<uchar> &key,                 \
+                                const std::vector<uchar> &iv,                  \
+                                const std::vector<uchar> &in, bool enc) {      \
+    AesContext ctx;                                                            \
+    AES_init_ctx(&ctx, key.data());                                            \
+    std::vector<uchar> out(in.size());                                         \
+    if (enc)                                                                   \
+      AES_CBC_encrypt_buffer(&ctx, out.data(), in.data(), in.size(),           \
+                             iv.data());                                       \
+    else                                                                       \
+      AES_CBC_decrypt_buffer(&ctx, out.data(), in.data(), in.size(),           \
+                             iv.data());                                       \
+    return out;                                                                \
+  }                                                                            \
+  /* Counter mode as decrypt_ELL_AES_CTR does it */                            \
+  static std::vector<uchar> ctr(const std::vector<uchar> &key,                 \
+                                const std::vector<uchar> &counter,             \
+                                const std::vector<uchar> &in) {                \
+    AesContext ctx;                                                            \
+    AES_init_ctx(&ctx, key.data());                                            \
+    uchar iv[16];                                                              \
+    memcpy(iv, counter.data(), 16);                                            \
+    std::vector<uchar> out(in.size());                                         \
+    for (size_t offset = 0; offset < in.size(); offset += 16) {                \
+      size_t block_size = std::min<size_t>(16, in.size() - offset);            \
+      uchar xordata[16];                                                       \
+      AES_ECB_encrypt(&ctx, iv, xordata);                                      \
+      xorit(xordata, (uchar *)&in[offset], &out[offset], block_size);          \
+      incrementIV(iv, sizeof(iv));                                             \
+    }                                                                          \
+    return out;                                                                \
+  }                                                                            \
+  static std::vector<uchar> cmac(const std::vector<uchar> &key,                \
+                                 const std::vector<uchar> &in) {               \
+    AesContext ctx;                                                            \
+    AES_init_ctx(&ctx, key.data());                                            \
+    std::vector<uchar> input(in), mac(16);                                     \
+    AES_CMAC(&ctx, input.data(), input.size(), mac.data());                    \
+    return mac;                                                                \
+  }                                                                            \
+  static bool rejects_missing_key() {                                          \
+    uchar block[16] = {}, mac[16];                                             \
+    return !AES_ECB_encrypt((const AesContext *)NULL, block, block) &&         \
+           !AES_CBC_decrypt_buffer(NULL, block, block, 16, block) &&           \
+           !AES_CMAC((const AesContext *)NULL, block, 16, mac);                \
+  }                                                                            \
+  }
+
+BACKEND_FUNCTIONS(software)
+BACKEND_FUNCTIONS(mbedtls_backend)
+
+// TPL mode 5 telegram from a driver test: the IV is the M and A fields of
+// the meter followed by 8 times the access number. Decryption is correct
+// when the plaintext starts with the 2f2f filler.
+struct TelegramVector {
+  const char *driver;
+  const char *key;
+  const char *iv;
+  const char *encrypted;
+};
+
+static const TelegramVector TELEGRAMS[] = {
+    {"waterstarm", "BEDB81B52C29B5C143388CBB0D15A051",
+     "FA12216209200206" "3636363636363636",
+     "67C94D48D00DC47B11213E23383DB51968A705AAFA60C60E263D50CD259D7C9A"},
+    {"aventieswm", "A004EB23329A477F1DD2D7820B56EB3D",
+     "2104710007612507" "B5B5B5B5B5B5B5B5",
+     "E2E95A3C2A1279A5415E6732679B43369FD5FDDDD783EEEBB48236D34E7C94AF"
+     "0A18A5FDA5F7D64111EB42D4D891622139F2952F9D12A20088DFA4CF81238711"
+     "23EE1F6C1DCEA414879DDB4E05E508F1826D7EFBA6964DF804C9261EA23BBF03"},
+};
+
+#define KNOWN_ANSWERS(ns)                                                      \
+  do {                                                                         \
+    const char *name = #ns;                                                    \
+    auto key = hex(KEY);                                                       \
+    auto plain = hex(PLAIN);                                                   \
+    /* NIST SP 800-38A F.1.1, F.1.2 */                                         \
+    auto ecb_cipher = hex("3ad77bb40d7a3660a89ecaf32466ef97"                   \
+                          "f5d3d58503b9699de785895a96fdbaaf"                   \
+                          "43b1cd7f598ece23881b00e3ed030688"                   \
+                          "7b0c785e27e8ad3f8223207104725dd4");                 \
+    expect(name, "ECB encrypt", ns::ecb(key, plain, true), ecb_cipher);        \
+    expect(name, "ECB decrypt", ns::ecb(key, ecb_cipher, false), plain);       \
+    /* NIST SP 800-38A F.2.1, F.2.2 */                                         \
+    auto iv = hex("000102030405060708090a0b0c0d0e0f");                         \
+    auto cbc_cipher = hex("7649abac8119b246cee98e9b12e9197d"                   \
+                          "5086cb9b507219ee95db113a917678b2"                   \
+                          "73bed6b8e3c1743b7116e69e22229516"                   \
+                          "3ff1caa1681fac09120eca307586e1a7");                 \
+    expect(name, "CBC encrypt", ns::cbc(key, iv, plain, true), cbc_cipher);    \
+    expect(name, "CBC decrypt", ns::cbc(key, iv, cbc_cipher, false), plain);   \
+    /* NIST SP 800-38A F.5.1 */                                                \
+    auto counter = hex("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff");                    \
+    expect(name, "CTR", ns::ctr(key, counter, plain),                          \
+           hex("874d6191b620e3261bef6864990db6ce"                              \
+               "9806f66b7970fdff8617187bb9fffdff"                              \
+               "5ae4df3edbd5d35e5b4f09020db03eab"                              \
+               "1e031dda2fbe03d1792170a0f3009cee"));                           \
+    /* RFC 4493 section 4 */                                                   \
+    expect(name, "CMAC 0", ns::cmac(key, {}),                                  \
+           hex("bb1d6929e95937287fa37d129b756746"));                           \
+    expect(name, "CMAC 16",                                                    \
+           ns::cmac(key, {plain.begin(), plain.begin() + 16}),                 \
+           hex("070a16b46b4d4144f79bdd9dd04a287c"));                           \
+    expect(name, "CMAC 40",                                                    \
+           ns::cmac(key, {plain.begin(), plain.begin() + 40}),                 \
+           hex("dfa66747de9ae63030ca32611497c827"));                           \
+    expect(name, "CMAC 64", ns::cmac(key, plain),                              \
+           hex("51f0bebf7e3b9d92fc49741779363cfe"));                           \
+    for (auto &t : TELEGRAMS) {                                                \
+      auto decrypted =                                                         \
+          ns::cbc(hex(t.key), hex(t.iv), hex(t.encrypted), false);             \
+      expect(name, t.driver, {decrypted.begin(), decrypted.begin() + 2},       \
+             hex("2f2f"));                                                     \
+    }                                                                          \
+    if (!ns::rejects_missing_key()) {                                          \
+      failures++;                                                              \
+      printf("FAIL %s NULL context accepted\n", name);                         \
+    }                                                                          \
+  } while (0)
+
+int main() {
+  KNOWN_ANSWERS(software);
+  KNOWN_ANSWERS(mbedtls_backend);
+
+  // Backends against each other
+  std::mt19937 rng(20240601);
+  auto random_bytes = [&](size_t n) {
+    std::vector<uchar> v(n);
+    for (auto &b : v)
+      b = rng();
+    return v;
+  };
+  const int ROUNDS = 2000;
+  for (int round = 0; round < ROUNDS; round++) {
+    auto key = random_bytes(16);
+    auto iv = random_bytes(16);
+    auto blocks = random_bytes(16 * (1 + rng() % 16));
+    auto bytes = random_bytes(rng() % 257);
+    std::string what = "round " + std::to_string(round);
+
+    expect("cross", (what + " ECB").c_str(),
+           mbedtls_backend::ecb(key, blocks, true),
+           software::ecb(key, blocks, true));
+    expect("cross", (what + " CBC encrypt").c_str(),
+           mbedtls_backend::cbc(key, iv, blocks, true),
+           software::cbc(key, iv, blocks, true));
+    expect("cross", (what + " CBC decrypt").c_str(),
+           mbedtls_backend::cbc(key, iv, blocks, false),
+           software::cbc(key, iv, blocks, false));
+    expect("cross", (what + " CTR").c_str(),
+           mbedtls_backend::ctr(key, iv, bytes),
+           software::ctr(key, iv, bytes));
+    expect("cross", (what + " CMAC").c_str(),
+           mbedtls_backend::cmac(key, bytes), software::cmac(key, bytes));
+  }
+
+  if (failures) {
+    printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("OK: known answers for both backends, %d random rounds identical\n",
+         ROUNDS);
+  return 0;
+}
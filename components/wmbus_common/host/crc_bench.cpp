@@ -0,0 +1,357 @@
+// Compares the table driven crc16_EN13757 and the in place crc trimming of
+// frame format A and B with the bitwise crc and the copying trim they
+// replaced, on random frames up to the longest ones, with and without a
+// broken crc. Build and run from components/wmbus_common:
+//
+//   g++ -std=c++17 -O2 -Ihost -I. host/crc_bench.cpp *.cpp
+//   ./a.out
+
+#include "util.h"
+#include "wmbus.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// crc16_EN13757 as it was before the lookup table
+static uint16_t legacyCrc16EN13757PerByte(uint16_t crc, uchar b) {
+  unsigned char i;
+
+  for (i = 0; i < 8; i++) {
+
+    if (((crc & 0x8000) >> 8) ^ (b & 0x80)) {
+      crc = (crc << 1) ^ 0x3D65;
+    } else {
+      crc = (crc << 1);
+    }
+
+    b <<= 1;
+  }
+
+  return crc;
+}
+
+static uint16_t legacyCrc16EN13757(uchar *data, size_t len) {
+  uint16_t crc = 0x0000;
+
+  for (size_t i = 0; i < len; ++i) {
+    crc = legacyCrc16EN13757PerByte(crc, data[i]);
+  }
+
+  return (~crc);
+}
+
+// trimCRCsFrameFormatAInternal and trimCRCsFrameFormatBInternal as they were
+// before trimming in place, using the bitwise crc above
+static bool legacyTrimCRCsFrameFormatA(std::vector<uchar> &payload,
+                                       bool fail_is_ok) {
+  if (payload.size() < 12) {
+    if (!fail_is_ok) {
+      debug("(wmbus) not enough bytes! expected at least 12 but got (%zu)!\n",
+            payload.size());
+    }
+    return false;
+  }
+  size_t len = payload.size();
+  if (!fail_is_ok) {
+    debugPayload("(wmbus) trimming frame A", payload);
+  }
+
+  std::vector<uchar> out;
+
+  uint16_t calc_crc = legacyCrc16EN13757(safeButUnsafeVectorPtr(payload), 10);
+  uint16_t check_crc = payload[10] << 8 | payload[11];
+
+  if (calc_crc != check_crc && !FUZZING) {
+    if (!fail_is_ok) {
+      debug("(wmbus) ff a dll crc first (calculated %04x) did not match "
+            "(expected %04x) for bytes 0-%zu!\n",
+            calc_crc, check_crc, 10);
+    }
+    return false;
+  }
+  out.insert(out.end(), payload.begin(), payload.begin() + 10);
+  if (!fail_is_ok) {
+    debug("(wmbus) ff a dll crc 0-%zu %04x ok\n", 10 - 1, calc_crc);
+  }
+
+  size_t pos = 12;
+  for (pos = 12; pos + 18 <= len; pos += 18) {
+    size_t to = pos + 16;
+    calc_crc = legacyCrc16EN13757(&payload[pos], 16);
+    check_crc = payload[to] << 8 | payload[to + 1];
+    if (calc_crc != check_crc && !FUZZING) {
+      if (!fail_is_ok) {
+        debug("(wmbus) ff a dll crc mid (calculated %04x) did not match "
+              "(expected %04x) for bytes %zu-%zu!\n",
+              calc_crc, check_crc, pos, to - 1);
+      }
+      return false;
+    }
+    out.insert(out.end(), payload.begin() + pos, payload.begin() + pos + 16);
+    if (!fail_is_ok) {
+      debug("(wmbus) ff a dll crc mid %zu-%zu %04x ok\n", pos, to - 1,
+            calc_crc);
+    }
+  }
+
+  if (pos < len - 2) {
+    size_t tto = len - 2;
+    size_t blen = (tto - pos);
+    calc_crc = legacyCrc16EN13757(&payload[pos], blen);
+    check_crc = payload[tto] << 8 | payload[tto + 1];
+    if (calc_crc != check_crc && !FUZZING) {
+      if (!fail_is_ok) {
+        debug("(wmbus) ff a dll crc final (calculated %04x) did not match "
+              "(expected %04x) for bytes %zu-%zu!\n",
+              calc_crc, check_crc, pos, tto - 1);
+      }
+      return false;
+    }
+    out.insert(out.end(), payload.begin() + pos, payload.begin() + tto);
+    if (!fail_is_ok) {
+      debug("(wmbus) ff a dll crc final %zu-%zu %04x ok\n", pos, tto - 1,
+            calc_crc);
+    }
+  }
+
+  debugPayload("(wmbus) trimming frame A", payload);
+
+  out[0] = out.size() - 1;
+  size_t new_len = out[0] + 1;
+  size_t old_size = payload.size();
+  payload = out;
+  size_t new_size = payload.size();
+
+  debug("(wmbus) trimmed %zu dll crc bytes from frame a and ignored %zu suffix "
+        "bytes.\n",
+        (len - new_len), (old_size - new_size) - (len - new_len));
+  debugPayload("(wmbus) trimmed frame A", payload);
+
+  return true;
+}
+
+static bool legacyTrimCRCsFrameFormatB(std::vector<uchar> &payload,
+                                       bool fail_is_ok) {
+  if (payload.size() < 12) {
+    if (!fail_is_ok) {
+      debug("(wmbus) not enough bytes! expected at least 12 but got (%zu)!\n",
+            payload.size());
+    }
+    return false;
+  }
+  size_t len = payload.size();
+  if (!fail_is_ok) {
+    debugPayload("(wmbus) trimming frame B", payload);
+  }
+
+  std::vector<uchar> out;
+  size_t crc1_pos, crc2_pos;
+  if (len <= 128) {
+    crc1_pos = len - 2;
+    crc2_pos = 0;
+  } else {
+    crc1_pos = 126;
+    crc2_pos = len - 2;
+  }
+
+  uchar *from1 = &payload[0];
+  size_t len1 = crc1_pos;
+  uint16_t calc_crc = legacyCrc16EN13757(from1, len1);
+  uint16_t check_crc = payload[crc1_pos] << 8 | payload[crc1_pos + 1];
+
+  if (calc_crc != check_crc && !FUZZING) {
+    if (!fail_is_ok) {
+      debug("(wmbus) ff b dll crc (calculated %04x) did not match (expected "
+            "%04x) for bytes 0-%zu!\n",
+            calc_crc, check_crc, crc1_pos);
+    }
+    return false;
+  }
+
+  out.insert(out.end(), payload.begin(), payload.begin() + crc1_pos);
+  if (!fail_is_ok) {
+    debug("(wmbus) ff b dll crc first 0-%zu %04x ok\n", crc1_pos, calc_crc);
+  }
+
+  if (crc2_pos > 0) {
+    uchar *from2 = &payload[crc1_pos+2];
+    size_t len2 = crc2_pos-crc1_pos-2;
+    calc_crc = legacyCrc16EN13757(from2, len2);
+    check_crc = payload[crc2_pos] << 8 | payload[crc2_pos + 1];
+
+    if (calc_crc != check_crc && !FUZZING) {
+      if (!fail_is_ok) {
+        debug("(wmbus) ff b dll crc (calculated %04x) did not match (expected "
+              "%04x) for bytes %zu-%zu!\n",
+              calc_crc, check_crc, crc1_pos + 2, crc2_pos);
+      }
+      return false;
+    }
+
+    out.insert(out.end(), payload.begin() + crc1_pos + 2,
+               payload.begin() + crc2_pos);
+    if (!fail_is_ok) {
+      debug("(wmbus) ff b dll crc final %zu-%zu %04x ok\n", crc1_pos + 2,
+            crc2_pos, calc_crc);
+    }
+  }
+
+  debugPayload("(wmbus) trimming frame B", payload);
+
+  out[0] = out.size() - 1;
+  size_t new_len = out[0] + 1;
+  size_t old_size = payload.size();
+  payload = out;
+  size_t new_size = payload.size();
+
+  debug("(wmbus) trimmed %zu dll crc bytes from frame b and ignored %zu suffix "
+        "bytes.\n",
+        (len - new_len), (old_size - new_size) - (len - new_len));
+  debugPayload("(wmbus) trimmed frame B", payload);
+
+  return true;
+}
+
+
+static void appendCrc(std::vector<uchar> &frame, size_t from) {
+  uint16_t crc = crc16_EN13757(&frame[from], frame.size() - from);
+  frame.push_back(crc >> 8);
+  frame.push_back(crc & 0xff);
+}
+
+// Frame format A: the L-field counts the bytes without crcs, the first block
+// is 10 bytes and the others 16, each followed by its crc.
+static std::vector<uchar> frameA(std::mt19937 &rng, uchar l_field) {
+  std::vector<uchar> frame;
+  for (size_t i = 0, block = 0; i <= l_field; i++) {
+    frame.push_back(i == 0 ? l_field : rng());
+    if (i == 9 || i == l_field || (i > 9 && (i - 9) % 16 == 0)) {
+      appendCrc(frame, block);
+      block = frame.size();
+    }
+  }
+  return frame;
+}
+
+// Frame format B: the L-field counts the crcs as well, one crc after the
+// first 126 bytes and one at the end of frames longer than 129 bytes.
+static std::vector<uchar> frameB(std::mt19937 &rng, size_t size) {
+  std::vector<uchar> frame;
+  for (size_t i = 0; i < size - (size > 128 ? 4 : 2); i++) {
+    frame.push_back(i == 0 ? size - 1 : rng());
+    if (i == 125 && size > 128)
+      appendCrc(frame, 0);
+  }
+  appendCrc(frame, size > 128 ? 128 : 0);
+  return frame;
+}
+
+template <typename F> static double ns_per_call(int rounds, F &&fn) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++)
+    fn(i);
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         rounds;
+}
+
+int main() {
+  std::mt19937 rng(19);
+  int failures = 0;
+
+  for (size_t size = 0; size <= 290; size++) {
+    std::vector<uchar> data(size);
+    for (auto &b : data)
+      b = rng();
+    if (crc16_EN13757(data.data(), size) !=
+        legacyCrc16EN13757(data.data(), size)) {
+      failures++;
+      printf("FAIL crc of %zu bytes\n", size);
+    }
+  }
+
+  // Valid frames of every length, then each with one flipped bit, 20 times
+  auto compare = [&](const char *format, std::vector<uchar> frame,
+                     bool (*trim)(std::vector<uchar> &),
+                     bool (*legacy)(std::vector<uchar> &, bool)) {
+    std::vector<uchar> trimmed = frame, expected = frame;
+    bool ok = trim(trimmed);
+    bool legacy_ok = legacy(expected, false);
+    if (ok != legacy_ok || trimmed != expected) {
+      failures++;
+      printf("FAIL frame %s of %zu bytes: %d, before %d\n", format,
+             frame.size(), ok, legacy_ok);
+    }
+    return ok;
+  };
+  size_t valid = 0, broken = 0;
+  for (int round = 0; round < 20; round++) {
+    for (int l_field = 9; l_field <= 255; l_field++) {
+      auto frame = frameA(rng, l_field);
+      valid += compare("A", frame, trimCRCsFrameFormatA,
+                       legacyTrimCRCsFrameFormatA);
+      frame[rng() % frame.size()] ^= 1 << (rng() % 8);
+      broken += !compare("A", frame, trimCRCsFrameFormatA,
+                         legacyTrimCRCsFrameFormatA);
+    }
+    for (size_t size = 12; size <= 256; size++) {
+      if (size == 129) // no room for the second crc
+        continue;
+      auto frame = frameB(rng, size);
+      valid += compare("B", frame, trimCRCsFrameFormatB,
+                       legacyTrimCRCsFrameFormatB);
+      frame[rng() % frame.size()] ^= 1 << (rng() % 8);
+      broken += !compare("B", frame, trimCRCsFrameFormatB,
+                         legacyTrimCRCsFrameFormatB);
+    }
+  }
+  printf("%zu valid frames trimmed, %zu broken frames rejected\n", valid,
+         broken);
+
+  // Longest frames: L = 255 is 290 bytes in format A and 256 in format B
+  auto longest_a = frameA(rng, 255);
+  auto longest_b = frameB(rng, 256);
+  const int ROUNDS = 20000;
+  volatile uint16_t sink = 0;
+  std::vector<uchar> payload;
+
+  double crc_ns = ns_per_call(ROUNDS, [&](int) {
+    sink = sink + crc16_EN13757(longest_a.data(), longest_a.size());
+  });
+  double legacy_crc_ns = ns_per_call(ROUNDS, [&](int) {
+    sink = sink + legacyCrc16EN13757(longest_a.data(), longest_a.size());
+  });
+  // Both include copying the frame into the reused payload
+  double a_ns = ns_per_call(ROUNDS, [&](int) {
+    payload = longest_a;
+    trimCRCsFrameFormatA(payload);
+  });
+  double legacy_a_ns = ns_per_call(ROUNDS, [&](int) {
+    payload = longest_a;
+    legacyTrimCRCsFrameFormatA(payload, false);
+  });
+  double b_ns = ns_per_call(ROUNDS, [&](int) {
+    payload = longest_b;
+    trimCRCsFrameFormatB(payload);
+  });
+  double legacy_b_ns = ns_per_call(ROUNDS, [&](int) {
+    payload = longest_b;
+    legacyTrimCRCsFrameFormatB(payload, false);
+  });
+
+  printf("crc16_EN13757 of %zu bytes: %.0f ns, bitwise %.0f ns\n",
+         longest_a.size(), crc_ns, legacy_crc_ns);
+  printf("trim frame A of %zu bytes:  %.0f ns, copying %.0f ns\n",
+         longest_a.size(), a_ns, legacy_a_ns);
+  printf("trim frame B of %zu bytes:  %.0f ns, copying %.0f ns\n",
+         longest_b.size(), b_ns, legacy_b_ns);
+
+  if (failures) {
+    printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,61 @@
+// Test telegrams of the drivers, for the host checks and benchmarks.
+//
+// They are read from the "// Test:" and "// telegram=" comments in the
+// driver_*.cpp sources, so run the programs from components/wmbus_common.
+#pragma once
+
+#include "util.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct DriverTest {
+  std::string name;
+  std::string driver;
+  std::string id;
+  std::string key; // empty for NOKEY
+  std::vector<uchar> frame;
+  std::string source;
+};
+
+inline std::vector<DriverTest> loadDriverTests(const std::string &dir = ".") {
+  std::vector<std::string> sources;
+  for (auto &entry : std::filesystem::directory_iterator(dir)) {
+    auto file = entry.path().filename().string();
+    if (file.rfind("driver_", 0) == 0 && entry.path().extension() == ".cpp")
+      sources.push_back(entry.path().string());
+  }
+  std::sort(sources.begin(), sources.end());
+
+  std::vector<DriverTest> tests;
+  for (auto &source : sources) {
+    std::ifstream in(source);
+    std::string line;
+    DriverTest current;
+    bool have_test = false;
+    while (std::getline(in, line)) {
+      if (line.rfind("// Test:", 0) == 0) {
+        std::istringstream fields(line.substr(8));
+        current = DriverTest();
+        fields >> current.name >> current.driver >> current.id >> current.key;
+        if (current.key == "NOKEY")
+          current.key.clear();
+        current.source = source;
+        have_test = !current.driver.empty();
+      } else if (have_test && line.rfind("// telegram=", 0) == 0) {
+        std::string hex;
+        for (char c : line.substr(12))
+          if (isHexChar(c))
+            hex += c;
+        DriverTest test = current;
+        if (hex2bin(hex, &test.frame) && !test.frame.empty())
+          tests.push_back(test);
+      }
+    }
+  }
+  return tests;
+}
@@ -0,0 +1,35 @@
+// Stand-in for the ESPHome logger in host builds of the checks and
+// benchmarks in this directory. Errors and warnings go to stderr, the rest
+// is dropped so it does not disturb the measurements.
+#pragma once
+
+#include <cstdio>
+
+#define esph_log_e(tag, ...)                                                   \
+  do {                                                                         \
+    fprintf(stderr, "[E][%s] ", tag);                                          \
+    fprintf(stderr, __VA_ARGS__);                                              \
+    fputc('\n', stderr);                                                       \
+  } while (0)
+#define esph_log_w(tag, ...)                                                   \
+  do {                                                                         \
+    fprintf(stderr, "[W][%s] ", tag);                                          \
+    fprintf(stderr, __VA_ARGS__);                                              \
+    fputc('\n', stderr);                                                       \
+  } while (0)
+#define esph_log_i(tag, ...)                                                   \
+  do {                                                                         \
+    if (0)                                                                     \
+      fprintf(stderr, __VA_ARGS__);                                            \
+  } while (0)
+#define esph_log_d esph_log_i
+#define esph_log_v esph_log_i
+#define esph_log_vv esph_log_i
+
+#define ESP_LOGE esph_log_e
+#define ESP_LOGW esph_log_w
+#define ESP_LOGI esph_log_i
+#define ESP_LOGD esph_log_d
+#define ESP_LOGV esph_log_v
+#define ESP_LOGVV esph_log_vv
+#define ESP_LOGCONFIG esph_log_i
@@ -0,0 +1,84 @@
+// Time of the calculated fields over all driver test telegrams.
+//
+// Each test telegram is handled once by a meter of its driver, then the
+// fields with a formula and no matcher are calculated again and again, as
+// processFieldCalculators does for every telegram on the device. The sum of
+// the results is printed so that runs on different versions of the formula
+// code can be compared. Build and run from components/wmbus_common:
+//
+//   g++ -std=c++17 -O2 -Ihost -I. host/formula_bench.cpp *.cpp
+//   ./a.out [rounds]
+
+#include "driver_tests.h"
+#include "meters.h"
+#include "wmbus.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+
+struct Calculated {
+  std::shared_ptr<Meter> meter;
+  std::vector<FieldInfo *> fields;
+};
+
+int main(int argc, char **argv) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 1000;
+
+  std::deque<Calculated> telegrams;
+  size_t handled = 0, fields = 0;
+  for (auto &test : loadDriverTests()) {
+    MeterInfo mi;
+    if (!mi.parse(test.name, test.driver, test.id, test.key))
+      continue;
+    auto meter = createMeter(&mi);
+    AboutTelegram about("", 0, FrameType::WMBUS);
+    std::vector<Address> addresses;
+    bool id_match = false;
+    Telegram t;
+    if (!meter || !meter->handleTelegram(about, test.frame, true, &addresses,
+                                         &id_match, &t))
+      continue;
+    handled++;
+
+    Calculated c{meter, {}};
+    for (FieldInfo &fi : meter->fieldInfos())
+      if (fi.hasFormula() && !fi.hasMatcher())
+        c.fields.push_back(&fi);
+    if (c.fields.empty())
+      continue;
+    fields += c.fields.size();
+    telegrams.push_back(c);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < rounds; round++)
+    for (auto &c : telegrams)
+      for (FieldInfo *fi : c.fields)
+        fi->performCalculation(c.meter.get());
+  auto end = std::chrono::steady_clock::now();
+
+  double sum = 0;
+  size_t nans = 0;
+  for (auto &c : telegrams) {
+    for (FieldInfo *fi : c.fields) {
+      double v = c.meter->getNumericValue(fi, fi->displayUnit());
+      if (std::isnan(v))
+        nans++;
+      else
+        sum += v;
+    }
+  }
+
+  double ns = std::chrono::duration<double, std::nano>(end - start).count();
+  printf("%zu telegrams handled, %zu with %zu calculated fields, %d rounds\n",
+         handled, telegrams.size(), fields, rounds);
+  printf("  %.1f ns per field, %.1f ns per telegram\n",
+         ns / (double(rounds) * fields),
+         ns / (double(rounds) * telegrams.size()));
+  printf("  sum of results %.17g, %zu nan\n", sum, nans);
+  return 0;
+}
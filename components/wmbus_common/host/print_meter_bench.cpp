@@ -0,0 +1,105 @@
+// Allocations and time of printMeter over all driver test telegrams.
+//
+// Each test telegram is handled once by a meter of its driver, then
+// printMeter renders the json of every handled telegram repeatedly into a
+// reused string, with the arguments Meter::as_json passes on the device.
+// Build and run from components/wmbus_common:
+//
+//   g++ -std=c++17 -O2 -Ihost -I. host/print_meter_bench.cpp *.cpp
+//   ./a.out [rounds]
+
+#include "driver_tests.h"
+#include "meters.h"
+#include "wmbus.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <new>
+
+static bool counting = false;
+static size_t allocations = 0;
+
+// Every replaceable form that allocates, so that all memory comes from and
+// goes back to malloc and all of it is counted.
+static void *allocate(size_t size) noexcept {
+  if (counting)
+    allocations++;
+  return malloc(size ? size : 1);
+}
+
+void *operator new(size_t size) {
+  if (void *p = allocate(size))
+    return p;
+  throw std::bad_alloc();
+}
+void *operator new[](size_t size) {
+  if (void *p = allocate(size))
+    return p;
+  throw std::bad_alloc();
+}
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return allocate(size);
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return allocate(size);
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { free(p); }
+
+struct Handled {
+  std::shared_ptr<Meter> meter;
+  Telegram telegram;
+};
+
+int main(int argc, char **argv) {
+  int rounds = argc > 1 ? atoi(argv[1]) : 100;
+
+  std::deque<Handled> handled;
+  for (auto &test : loadDriverTests()) {
+    MeterInfo mi;
+    if (!mi.parse(test.name, test.driver, test.id, test.key))
+      continue;
+    handled.emplace_back();
+    auto &h = handled.back();
+    h.meter = createMeter(&mi);
+    AboutTelegram about("", 0, FrameType::WMBUS);
+    std::vector<Address> addresses;
+    bool id_match = false;
+    if (!h.meter ||
+        !h.meter->handleTelegram(about, test.frame, true, &addresses,
+                                 &id_match, &h.telegram))
+      handled.pop_back();
+  }
+
+  std::string json;
+  auto print = [&](Handled &h) {
+    h.meter->printMeter(&h.telegram, nullptr, nullptr, '\t', &json, nullptr,
+                        nullptr, nullptr, false);
+  };
+
+  // Let the reused string reach its final capacity
+  for (auto &h : handled)
+    print(h);
+
+  counting = true;
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < rounds; round++)
+    for (auto &h : handled)
+      print(h);
+  auto end = std::chrono::steady_clock::now();
+  counting = false;
+
+  double calls = double(rounds) * handled.size();
+  double ns = std::chrono::duration<double, std::nano>(end - start).count();
+  printf("printMeter: %zu telegrams, %d rounds\n", handled.size(), rounds);
+  printf("  %.1f allocations per call\n", allocations / calls);
+  printf("  %.2f us per call\n", ns / calls / 1000);
+  return 0;
+}
@@ -0,0 +1,87 @@
+// Time of the driver registry: static initialization, which registers the
+// drivers, the first lookup and the lookups done per telegram.
+//
+// Static initialization is measured from a clock read before every other
+// static initializer up to main, so it covers the whole library and not
+// only the drivers. On the device the "driver registry" phase of the
+// startup profile shows the first lookup. Build and run from
+// components/wmbus_common:
+//
+//   g++ -std=c++17 -O2 -Ihost -I. host/registry_bench.cpp *.cpp
+//   ./a.out [rounds]
+
+#include "meters.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static Clock::time_point process_start __attribute__((init_priority(101))) =
+    Clock::now();
+
+static double us_since(Clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - start)
+      .count();
+}
+
+struct Detection {
+  std::string driver;
+  DriverDetect detect;
+};
+
+int main(int argc, char **argv) {
+  double static_init_us = us_since(process_start);
+  int rounds = argc > 1 ? atoi(argv[1]) : 1000;
+
+  auto start = Clock::now();
+  volatile bool found = lookupDriver("multical21") != NULL;
+  double first_lookup_us = us_since(start);
+
+  std::vector<std::string> names;
+  std::vector<Detection> detections;
+  for (DriverInfo *di : allDrivers()) {
+    names.push_back(di->name().str());
+    for (auto &d : di->detect())
+      detections.push_back({di->name().str(), d});
+  }
+
+  start = Clock::now();
+  for (int round = 0; round < rounds; round++)
+    for (auto &name : names)
+      found = lookupDriver(name) != NULL;
+  double lookup_ns = us_since(start) * 1000 / (double(rounds) * names.size());
+
+  start = Clock::now();
+  for (int round = 0; round < rounds; round++)
+    for (auto &d : detections)
+      found = isMeterDriverValid(DriverName(d.driver), d.detect.mfct,
+                                 d.detect.type, d.detect.version);
+  double valid_ns =
+      us_since(start) * 1000 / (double(rounds) * detections.size());
+
+  std::vector<std::string> drivers;
+  start = Clock::now();
+  for (int round = 0; round < rounds; round++) {
+    for (auto &d : detections) {
+      drivers.clear();
+      detectMeterDrivers(d.detect.mfct, d.detect.type, d.detect.version,
+                         &drivers);
+    }
+  }
+  double detect_ns =
+      us_since(start) * 1000 / (double(rounds) * detections.size());
+  (void)found;
+
+  printf("%zu drivers, %zu detection entries, %d rounds\n", names.size(),
+         detections.size(), rounds);
+  printf("  static initialization: %.0f us\n", static_init_us);
+  printf("  first lookup:          %.0f us\n", first_lookup_us);
+  printf("  lookupDriver:          %.0f ns\n", lookup_ns);
+  printf("  isMeterDriverValid:    %.0f ns\n", valid_ns);
+  printf("  detectMeterDrivers:    %.0f ns\n", detect_ns);
+  return 0;
+}
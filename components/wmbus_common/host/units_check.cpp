@@ -0,0 +1,197 @@
+// Checks the unit conversion table in units.cpp against the if chain it
+// replaced, for every pair of units, and measures both. Build and run from
+// components/wmbus_common:
+//
+//   g++ -std=c++17 -O2 -Ihost -I. host/units_check.cpp units.cpp util.cpp
+//   ./a.out
+
+#include "units.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// The conversions as units.cpp listed them before the table, one code block
+// per pair, and the functions that scanned them.
+#define LEGACY_LIST_OF_CONVERSIONS                                             \
+  X(Second, Minute, { vto = vfrom / 60.0; })                                   \
+  X(Minute, Second, { vto = vfrom * 60.0; })                                   \
+  X(Second, Hour, { vto = vfrom / 3600.0; })                                   \
+  X(Hour, Second, { vto = vfrom * 3600.0; })                                   \
+  X(Year, Second, { vto = vfrom * 3600.0 * 24.0 * 365.2425; })                 \
+  X(Second, Year, { vto = vfrom / 3600.0 / 24.0 / 365.2425; })                 \
+  X(Minute, Hour, { vto = vfrom / 60.0; })                                     \
+  X(Hour, Minute, { vto = vfrom * 60.0; })                                     \
+  X(Minute, Year, { vto = vfrom / 60.0 / 24.0 / 365.2425; })                   \
+  X(Year, Minute, { vto = vfrom * 60.0 * 24.0 * 365.2425; })                   \
+  X(Hour, Year, { vto = vfrom / 24.0 / 365.2425; })                            \
+  X(Year, Hour, { vto = vfrom * 24.0 * 365.2425; })                            \
+  X(Hour, Day, { vto = vfrom / 24.0; })                                        \
+  X(Day, Hour, { vto = vfrom * 24.0; })                                        \
+  X(Day, Year, { vto = vfrom / 365.2425; })                                    \
+  X(Year, Day, { vto = vfrom * 365.2425; })                                    \
+  X(WH, KWH, { vto = vfrom / 1000.0; })                                        \
+  X(KWH, GJ, { vto = vfrom * 0.0036; })                                        \
+  X(KWH, MJ, { vto = vfrom * 0.0036 * 1000.0; })                               \
+  X(GJ, KWH, { vto = vfrom / 0.0036; })                                        \
+  X(MJ, GJ, { vto = vfrom / 1000.0; })                                         \
+  X(MJ, KWH, { vto = vfrom / 1000.0 / 0.0036; })                               \
+  X(GJ, MJ, { vto = vfrom * 1000.0; })                                         \
+  X(W, KW, { vto = vfrom / 1000.0; })                                          \
+  X(JH, W, { vto = vfrom / 3600.0; })                                          \
+  X(W, JH, { vto = vfrom * 3600.0; })                                          \
+  X(MJH, KW, { vto = vfrom / 1000.0 / 0.0036; })                               \
+  X(KW, MJH, { vto = vfrom * 0.0036 * 1000.0; })                               \
+  X(M3, L, { vto = vfrom * 1000.0; })                                          \
+  X(M3H, LH, { vto = vfrom * 1000.0; })                                        \
+  X(L, M3, { vto = vfrom / 1000.0; })                                          \
+  X(LH, M3H, { vto = vfrom / 1000.0; })                                        \
+  X(C, K, { vto = vfrom + 273.15; })                                           \
+  X(K, C, { vto = vfrom - 273.15; })                                           \
+  X(C, F, { vto = (vfrom * 9.0 / 5.0) + 32.0; })                               \
+  X(F, C, { vto = (vfrom - 32) * 5.0 / 9.0; })                                 \
+  X(PA, BAR, { vto = vfrom / 100000.0; })                                      \
+  X(BAR, PA, { vto = vfrom * 100000.0; })                                      \
+  X(COUNTER, FACTOR, { vto = vfrom; })                                         \
+  X(FACTOR, COUNTER, { vto = vfrom; })                                         \
+  X(COUNTER, NUMBER, { vto = vfrom; })                                         \
+  X(NUMBER, COUNTER, { vto = vfrom; })                                         \
+  X(FACTOR, NUMBER, { vto = vfrom; })                                          \
+  X(NUMBER, FACTOR, { vto = vfrom; })                                          \
+  X(PERCENTAGE, NUMBER, { vto = vfrom; })                                      \
+  X(NUMBER, PERCENTAGE, { vto = vfrom; })                                      \
+  X(UnixTimestamp, DateTimeLT, { vto = vfrom; })                               \
+  X(DateTimeLT, UnixTimestamp, { vto = vfrom; })                               \
+  X(DateLT, UnixTimestamp, { vto = vfrom; })                                   \
+  X(DateTimeLT, DateLT, { vto = vfrom; })                                      \
+  X(DateLT, DateTimeLT, { vto = vfrom; })                                      \
+  X(DEGREE, RADIAN, { vto = vfrom * M_PI / 180.0; })                           \
+  X(RADIAN, DEGREE, { vto = vfrom * 180.0 / M_PI; })
+
+static bool legacyCanConvert(Unit ufrom, Unit uto) {
+  if (ufrom == uto)
+    return true;
+#define X(from, to, code)                                                      \
+  if (Unit::from == ufrom && Unit::to == uto)                                  \
+    return true;
+  LEGACY_LIST_OF_CONVERSIONS
+#undef X
+  return false;
+}
+
+static double legacyConvert(double vfrom, Unit ufrom, Unit uto) {
+  double vto = -4711.0;
+  if (ufrom == uto) {
+    { vto = vfrom; }
+    return vto;
+  }
+
+#define X(from, to, code)                                                      \
+  if (Unit::from == ufrom && Unit::to == uto) {                                \
+    code return vto;                                                           \
+  }
+  LEGACY_LIST_OF_CONVERSIONS
+#undef X
+  return vto;
+}
+
+static const size_t NUM_UNITS = (size_t)Unit::Unknown + 1;
+
+static const double VALUES[] = {0.0,    1.0,     -1.0,    0.001,  12.5,
+                                -40.0,  32.0,    273.15,  3.6,    1e6,
+                                0.1,    -0.5,    1e-9,    1e12,   86400.0,
+                                4711.0, 123.456, -1234.5, 1.0e9,  1.0 / 3.0};
+
+// Distance in units in the last place, 0 for equal values
+static double ulps(double a, double b) {
+  if (a == b)
+    return 0;
+  return fabs(a - b) / std::nextafter(std::max(fabs(a), fabs(b)), INFINITY) /
+         2.220446049250313e-16;
+}
+
+int main() {
+  int failures = 0;
+  size_t pairs = 0, convertible = 0;
+  double worst_ulps = 0;
+  Unit worst_from = Unit::Unknown, worst_to = Unit::Unknown;
+
+  for (size_t f = 0; f < NUM_UNITS; f++) {
+    for (size_t t = 0; t < NUM_UNITS; t++) {
+      Unit from = (Unit)f, to = (Unit)t;
+      pairs++;
+      bool can = canConvert(from, to);
+      if (can != legacyCanConvert(from, to)) {
+        failures++;
+        printf("FAIL canConvert %s -> %s: %d\n", unitToStringHR(from).c_str(),
+               unitToStringHR(to).c_str(), can);
+        continue;
+      }
+      if (!can)
+        continue;
+      convertible++;
+
+      for (double v : VALUES) {
+        double table = convert(v, from, to);
+        double legacy = legacyConvert(v, from, to);
+        double u = ulps(table, legacy);
+        // Folding a chain of operations into one scale may round the last
+        // bit differently, and F -> C loses a little near 32 where
+        // (v - 32) cancels.
+        bool close = u <= 4 || fabs(table - legacy) < 1e-13;
+        if (!close) {
+          failures++;
+          printf("FAIL convert %g %s -> %s: %.17g, before %.17g\n", v,
+                 unitToStringHR(from).c_str(), unitToStringHR(to).c_str(),
+                 table, legacy);
+        }
+        if (u > worst_ulps && fabs(table - legacy) >= 1e-13) {
+          worst_ulps = u;
+          worst_from = from;
+          worst_to = to;
+        }
+      }
+    }
+  }
+
+  printf("%zu unit pairs, %zu convertible, worst difference %.1f ulp (%s -> "
+         "%s)\n",
+         pairs, convertible, worst_ulps, unitToStringHR(worst_from).c_str(),
+         unitToStringHR(worst_to).c_str());
+
+  // Time both over every convertible pair
+  std::vector<std::pair<Unit, Unit>> convertible_pairs;
+  for (size_t f = 0; f < NUM_UNITS; f++)
+    for (size_t t = 0; t < NUM_UNITS; t++)
+      if (canConvert((Unit)f, (Unit)t))
+        convertible_pairs.push_back({(Unit)f, (Unit)t});
+
+  const int ROUNDS = 20000;
+  volatile double sink = 0;
+  auto measure = [&](auto &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < ROUNDS; round++)
+      for (auto &p : convertible_pairs)
+        sink = sink + fn(round, p.first, p.second);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() /
+           (double(ROUNDS) * convertible_pairs.size());
+  };
+  double table_ns = measure([](int v, Unit from, Unit to) {
+    return canConvert(from, to) ? convert(v, from, to) : 0.0;
+  });
+  double legacy_ns = measure([](int v, Unit from, Unit to) {
+    return legacyCanConvert(from, to) ? legacyConvert(v, from, to) : 0.0;
+  });
+  printf("canConvert + convert: %.1f ns per pair, if chain %.1f ns\n",
+         table_ns, legacy_ns);
+
+  if (failures) {
+    printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,115 @@
+// Streaming writer for the flat json objects printed for telegrams.
+#include "json_writer.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+static const char *INDENT = "    ";
+
+void JsonWriter::beginObject() {
+  out_->push_back('{');
+  if (pretty_print_)
+    out_->push_back('\n');
+  first_ = true;
+}
+
+void JsonWriter::endObject() {
+  if (pretty_print_)
+    out_->push_back('\n');
+  out_->push_back('}');
+}
+
+void JsonWriter::separator() {
+  if (!first_) {
+    out_->push_back(',');
+    if (pretty_print_)
+      out_->push_back('\n');
+  }
+  first_ = false;
+  if (pretty_print_)
+    out_->append(INDENT);
+}
+
+void JsonWriter::key(const char *k, const char *suffix1, const char *suffix2) {
+  separator();
+  out_->push_back('"');
+  key_start_ = out_->size();
+  out_->append(k);
+  out_->append(suffix1);
+  out_->append(suffix2);
+  key_len_ = out_->size() - key_start_;
+  out_->append("\":");
+}
+
+void JsonWriter::key(const char *k, size_t len) {
+  separator();
+  out_->push_back('"');
+  key_start_ = out_->size();
+  out_->append(k, len);
+  key_len_ = len;
+  out_->append("\":");
+}
+
+void JsonWriter::repeatKey(const char *suffix) {
+  size_t start = key_start_;
+  size_t len = key_len_;
+  separator();
+  out_->push_back('"');
+  key_start_ = out_->size();
+  out_->append(*out_, start, len);
+  out_->append(suffix);
+  key_len_ = out_->size() - key_start_;
+  out_->append("\":");
+}
+
+void JsonWriter::stringValue(const char *v) { stringValue(v, strlen(v)); }
+
+void JsonWriter::stringValue(const char *v, size_t len) {
+  out_->push_back('"');
+  out_->append(v, len);
+  out_->push_back('"');
+}
+
+void JsonWriter::numberValue(double v) {
+  if (std::isnan(v)) {
+    nullValue();
+    return;
+  }
+  // This rounds the double value to 6 decimal digits, the same as
+  // std::to_string.
+  char buf[512];
+  int n = snprintf(buf, sizeof(buf), "%f", v);
+  if (n < 0)
+    n = 0;
+  if ((size_t)n >= sizeof(buf))
+    n = sizeof(buf) - 1;
+  while (n > 0 && buf[n - 1] == '0')
+    n--;
+  if (n > 0 && buf[n - 1] == '.')
+    n--;
+  if (n == 0) {
+    out_->push_back('0');
+    return;
+  }
+  out_->append(buf, n);
+}
+
+void JsonWriter::integerValue(long long v) {
+  char buf[24];
+  int n = snprintf(buf, sizeof(buf), "%lld", v);
+  out_->append(buf, n);
+}
+
+void JsonWriter::nullValue() { out_->append("null"); }
+
+void JsonWriter::constantField(const std::string &key_value) {
+  size_t p = key_value.find('=');
+  if (p == std::string::npos) {
+    key(key_value.data(), key_value.size());
+    stringValue("", 0);
+    return;
+  }
+  key(key_value.data(), p);
+  stringValue(key_value.data() + p + 1, key_value.size() - p - 1);
+}
@@ -0,0 +1,46 @@
+// Streaming writer for the flat json objects printed for telegrams.
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <cstddef>
+#include <string>
+
+// Appends members to a caller owned buffer without building temporary
+// strings, so a buffer reused between telegrams keeps its capacity and
+// printing does not allocate. Like the rest of the json generation nothing
+// is escaped.
+struct JsonWriter {
+  JsonWriter(std::string *out, bool pretty_print)
+      : out_(out), pretty_print_(pretty_print) {}
+
+  void beginObject();
+  void endObject();
+
+  // Start a member, the key is the concatenation of the parts.
+  void key(const char *k, const char *suffix1 = "", const char *suffix2 = "");
+  void key(const char *k, size_t len);
+  // Start a member whose key is the previous key plus a suffix.
+  void repeatKey(const char *suffix);
+
+  void stringValue(const char *v);
+  void stringValue(const char *v, size_t len);
+  void stringValue(const std::string &v) { stringValue(v.data(), v.size()); }
+  // Formatted like valueToString, nan is printed as null.
+  void numberValue(double v);
+  void integerValue(long long v);
+  void nullValue();
+
+  // A key=value string from the extra constant fields.
+  void constantField(const std::string &key_value);
+
+private:
+  void separator();
+
+  std::string *out_;
+  bool pretty_print_;
+  bool first_ = true;
+  size_t key_start_ = 0;
+  size_t key_len_ = 0;
+};
+
+#endif
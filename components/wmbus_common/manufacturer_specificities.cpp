@@ -352,7 +352,7 @@ const char *toString(DiehlAddressTransformMethod m) {
 void qdsExtractWalkByField(Telegram *t, Meter *driver, DVEntry &mfctEntry,
                            int pos, int n, const std::string &key_s,
                            const std::string &fieldName, Quantity quantity) {
-  std::string bytes = mfctEntry.value.substr(pos, n);
+  std::string bytes = mfctEntry.value().substr(pos, n);
 
   DifVifKey key(key_s);
   DVEntry fieldEntry(0, key, MeasurementType::Instantaneous, key.vif(),
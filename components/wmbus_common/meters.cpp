@@ -17,6 +17,7 @@
 
 #include "meters.h"
 #include "meters_common_implementation.h"
+#include "startup_profiler.h"
 #include "units.h"
 #include "wmbus.h"
 #include "wmbus_utils.h"
@@ -30,66 +31,131 @@
 #include <stdexcept>
 #include <time.h>
 
-std::map<std::string, DriverInfo> *registered_drivers_ = NULL;
-std::vector<DriverInfo *> *registered_drivers_list_ = NULL;
-
-void verifyDriverLookupCreated() {
-  if (registered_drivers_ == NULL) {
-    registered_drivers_ = new std::map<std::string, DriverInfo>;
-  }
-  if (registered_drivers_list_ == NULL) {
-    registered_drivers_list_ = new std::vector<DriverInfo *>;
+// Drivers register from static initializers, where registering only stores
+// the setup function. The driver infos and the indexes used to look them up
+// are built when a driver is looked up for the first time.
+std::vector<DriverSetup> *registered_driver_setups_ = NULL;
+
+// A driver name or alias.
+struct DriverNameEntry {
+  const std::string *name;
+  bool alias;
+  DriverInfo *di;
+};
+
+// A detection triple, the mfct is restricted to 15 bits like in detect().
+struct DriverDetectEntry {
+  uint32_t key;
+  DriverInfo *di;
+};
+
+static uint32_t detectKey(uint16_t mfct, uchar type, uchar version) {
+  return (uint32_t)(mfct & 0x7fff) << 16 | (uint32_t)type << 8 | version;
+}
+
+struct DriverRegistry {
+  // In registration order, reserved up front so the pointers stay valid.
+  std::vector<DriverInfo> drivers;
+  std::vector<DriverInfo *> list;
+  // Sorted by name, a name comes before an equal alias.
+  std::vector<DriverNameEntry> names;
+  // Sorted by key, drivers with the same key in registration order.
+  std::vector<DriverDetectEntry> detects;
+};
+
+DriverRegistry *driver_registry_ = NULL;
+
+static DriverRegistry &driverRegistry() {
+  if (driver_registry_ != NULL)
+    return *driver_registry_;
+
+  StartupPhaseScope phase("driver registry");
+  driver_registry_ = new DriverRegistry;
+  DriverRegistry &r = *driver_registry_;
+  if (registered_driver_setups_ == NULL)
+    return r;
+
+  r.drivers.reserve(registered_driver_setups_->size());
+  for (DriverSetup setup : *registered_driver_setups_) {
+    r.drivers.emplace_back();
+    setup(r.drivers.back());
+  }
+  delete registered_driver_setups_;
+  registered_driver_setups_ = NULL;
+
+  for (DriverInfo &di : r.drivers) {
+    r.list.push_back(&di);
+    r.names.push_back({&di.name().str(), false, &di});
+    for (DriverName &dn : di.nameAliases())
+      r.names.push_back({&dn.str(), true, &di});
+    for (DriverDetect &d : di.detect()) {
+      if (d.mfct == 0 && d.type == 0 && d.version == 0)
+        continue; // Ignore drivers with no detection.
+      r.detects.push_back({detectKey(d.mfct, d.type, d.version), &di});
+    }
   }
-}
-
-DriverInfo *lookupDriver(std::string name) {
-  verifyDriverLookupCreated();
 
-  // Check if we have a compiled/loaded driver available.
-  if (registered_drivers_->count(name) == 1) {
-    return &(*registered_drivers_)[name];
+  std::stable_sort(r.names.begin(), r.names.end(),
+                   [](const DriverNameEntry &a, const DriverNameEntry &b) {
+                     int c = a.name->compare(*b.name);
+                     return c < 0 || (c == 0 && !a.alias && b.alias);
+                   });
+  for (size_t i = 1; i < r.names.size(); i++) {
+    if (!r.names[i].alias && !r.names[i - 1].alias &&
+        *r.names[i].name == *r.names[i - 1].name) {
+      error("Two drivers trying to register the name \"%s\"\n",
+            r.names[i].name->c_str());
+      exit(1);
+    }
   }
 
-  // No, ok lets look for driver aliases.
-  for (DriverInfo *di : *registered_drivers_list_) {
-    for (DriverName &dn : di->nameAliases()) {
-      if (dn.str() == name) {
-        return di;
+  std::stable_sort(r.detects.begin(), r.detects.end(),
+                   [](const DriverDetectEntry &a, const DriverDetectEntry &b) {
+                     return a.key < b.key;
+                   });
+  // Check that no other driver also triggers on the same detection values.
+  for (size_t i = 1; i < r.detects.size(); i++) {
+    DriverDetectEntry &e = r.detects[i];
+    for (size_t j = i; j > 0 && r.detects[j - 1].key == e.key; j--) {
+      DriverInfo *p = r.detects[j - 1].di;
+      if (p != e.di) {
+        error("Internal error: driver %s tried to register the same auto "
+              "detect combo as driver %s alread has taken!\n",
+              e.di->name().str().c_str(), p->name().str().c_str());
+        break;
       }
     }
   }
 
-  return NULL;
+  return r;
 }
 
-std::vector<DriverInfo *> &allDrivers() { return *registered_drivers_list_; }
-
-void removeDriver(const std::string &name) {
-  for (auto i = registered_drivers_list_->begin();
-       i != registered_drivers_list_->end(); i++) {
-    if ((*i)->name().str() == name) {
-      registered_drivers_list_->erase(i);
-      break;
-    }
-  }
-
-  registered_drivers_->erase(name);
-  assert(registered_drivers_->count(name) == 0);
+// Return the first of the detection entries with the key, the matching
+// entries follow it.
+static std::vector<DriverDetectEntry>::iterator
+findDetect(DriverRegistry &r, int mfct, int type, int version) {
+  uint32_t key = detectKey(mfct, type, version);
+  return std::lower_bound(
+      r.detects.begin(), r.detects.end(), key,
+      [](const DriverDetectEntry &e, uint32_t k) { return e.key < k; });
 }
 
-void addRegisteredDriver(DriverInfo di) {
-  verifyDriverLookupCreated();
-  if (registered_drivers_->count(di.name().str()) != 0) {
-    error("Two drivers trying to register the name \"%s\"\n",
-          di.name().str().c_str());
-    exit(1);
-  }
+DriverInfo *lookupDriver(std::string name) {
+  DriverRegistry &r = driverRegistry();
+
+  auto i = std::lower_bound(
+      r.names.begin(), r.names.end(), name,
+      [](const DriverNameEntry &e, const std::string &n) {
+        return e.name->compare(n) < 0;
+      });
+  if (i != r.names.end() && *i->name == name)
+    return i->di;
 
-  (*registered_drivers_)[di.name().str()] = di;
-  // The list elements points into the map.
-  (*registered_drivers_list_).push_back(lookupDriver(di.name().str()));
+  return NULL;
 }
 
+std::vector<DriverInfo *> &allDrivers() { return driverRegistry().list; }
+
 bool DriverInfo::detect(uint16_t mfct, uchar type, uchar version) {
   for (auto &dd : detect_) {
     if (dd.mfct == 0 && dd.type == 0 && dd.version == 0)
@@ -123,61 +189,14 @@ bool DriverInfo::isCloseEnoughMedia(uchar type) {
   return false;
 }
 
-bool forceRegisterDriver(std::function<void(DriverInfo &)> setup) {
-  DriverInfo di;
-  setup(di);
-
-  // Check that the driver name has not been registered before!
-  assert(lookupDriver(di.name().str()) == NULL);
-
-  // Check that no other driver also triggers on the same detection values.
-  for (auto &d : di.detect()) {
-    for (DriverInfo *p : allDrivers()) {
-      bool foo = p->detect(d.mfct, d.type, d.version);
-      if (foo) {
-        error("Internal error: driver %s tried to register the same auto "
-              "detect combo as driver %s alread has taken!\n",
-              di.name().str().c_str(), p->name().str().c_str());
-      }
-    }
-  }
-
-  // Everything looks, good install this driver.
-  addRegisteredDriver(di);
-
-  // This code is invoked from the static initializers of DriverInfos when
-  // starting wmbusmeters. Thus we do not yet know if the user has supplied
-  // --debug or similar setting. To debug this you have to uncomment the printf
-  // below. fprintf(stderr, "(STATIC) added driver: %s\n", n.c_str());
-  return true;
-}
-
-bool registerDriver(std::function<void(DriverInfo &)> setup) {
-  DriverInfo di;
-  setup(di);
-
-  // Check that the driver name has not been registered before!
-  assert(lookupDriver(di.name().str()) == NULL);
-
-  // Check that no other driver also triggers on the same detection values.
-  for (auto &d : di.detect()) {
-    for (DriverInfo *p : allDrivers()) {
-      bool foo = p->detect(d.mfct, d.type, d.version);
-      if (foo) {
-        error("Internal error: driver %s tried to register the same auto "
-              "detect combo as driver %s alread has taken!\n",
-              di.name().str().c_str(), p->name().str().c_str());
-      }
-    }
-  }
+bool registerDriver(DriverSetup setup) {
+  // The driver infos have already been built, too late to register.
+  assert(driver_registry_ == NULL);
 
-  // Everything looks, good install this driver.
-  addRegisteredDriver(di);
+  if (registered_driver_setups_ == NULL)
+    registered_driver_setups_ = new std::vector<DriverSetup>;
+  registered_driver_setups_->push_back(setup);
 
-  // This code is invoked from the static initializers of DriverInfos when
-  // starting wmbusmeters. Thus we do not yet know if the user has supplied
-  // --debug or similar setting. To debug this you have to uncomment the printf
-  // below. fprintf(stderr, "(STATIC) added driver: %s\n", n.c_str());
   return true;
 }
 
@@ -207,6 +226,8 @@ MeterCommonImplementation::MeterCommonImplementation(MeterInfo &mi,
 
   if (mi.key.length() > 0) {
     hex2bin(mi.key, &meter_keys_.confidentiality_key);
+    // Expand the key schedule now rather than on the first telegram.
+    meter_keys_.confidentialityContext();
   }
   for (auto s : mi.shells) {
     addShellMeterUpdated(s);
@@ -759,8 +780,12 @@ std::string concatFields(Meter *m, Telegram *t, char c,
 bool MeterCommonImplementation::handleTelegram(
     AboutTelegram &about, std::vector<uchar> input_frame, bool simulated,
     std::vector<Address> *addresses, bool *id_match, Telegram *out_analyzed) {
-  std::unique_ptr<Telegram> tp(new Telegram());
-  Telegram &t = *tp;
+  // The dv entries are views into the frame of the telegram that parsed
+  // them, so parse straight into out_analyzed instead of copying.
+  std::unique_ptr<Telegram> tp;
+  if (out_analyzed == NULL)
+    tp.reset(new Telegram());
+  Telegram &t = out_analyzed != NULL ? *out_analyzed : *tp;
   t.about = about;
   bool ok = t.parseHeader(input_frame);
 
@@ -776,15 +801,46 @@ bool MeterCommonImplementation::handleTelegram(
     return false;
   }
 
+  return handleMatchedTelegram(t, t.addresses.back(), input_frame, id_match);
+}
+
+bool MeterCommonImplementation::handleTelegram(
+    AboutTelegram &about, const Telegram &header,
+    const std::vector<uchar> &input_frame, bool simulated,
+    std::vector<Address> *addresses, bool *id_match, Telegram *out_analyzed) {
+  *addresses = header.addresses;
+
+  bool used_wildcard = false;
+  if (!doesTelegramMatchExpressions(*addresses, address_expressions_,
+                                    &used_wildcard)) {
+    // This telegram is not intended for this meter.
+    debug("(meter) %s: not for me: no match\n", name().c_str());
+    return false;
+  }
+
+  Telegram local;
+  Telegram &t = out_analyzed != NULL ? *out_analyzed : local;
+  t.about = about;
+  t.meter = this;
+
+  if (simulated)
+    t.markAsSimulated();
+  if (out_analyzed != NULL)
+    t.markAsBeingAnalyzed();
+
+  return handleMatchedTelegram(t, addresses->back(), input_frame, id_match);
+}
+
+bool MeterCommonImplementation::handleMatchedTelegram(
+    Telegram &t, Address &address, const std::vector<uchar> &input_frame,
+    bool *id_match) {
   *id_match = true;
 
   verbose("(meter) %s(%d) %s  handling telegram from %s\n", name().c_str(),
-          index(), driverName().str().c_str(),
-          t.addresses.back().str().c_str());
+          index(), driverName().str().c_str(), address.str().c_str());
 
-  std::string msg = bin2hex(input_frame);
-  debug("(meter) %s %s \"%s\"\n", name().c_str(),
-        t.addresses.back().str().c_str(), msg.c_str());
+  debug("(meter) %s %s \"%s\"\n", name().c_str(), address.str().c_str(),
+        bin2hex(input_frame).c_str());
 
   // For older meters with manufacturer specific data without a nice 0f dif
   // marker.
@@ -792,10 +848,8 @@ bool MeterCommonImplementation::handleTelegram(
     t.force_mfct_index = force_mfct_index_;
   }
 
-  ok = t.parse(input_frame, &meter_keys_, true);
+  bool ok = t.parse(input_frame, &meter_keys_, true);
   if (!ok) {
-    if (out_analyzed != NULL)
-      *out_analyzed = t;
     // Ignoring telegram since it could not be parsed.
     return false;
   }
@@ -820,29 +874,50 @@ bool MeterCommonImplementation::handleTelegram(
 
   triggerUpdate(&t);
 
-  if (out_analyzed != NULL)
-    *out_analyzed = t;
   return true;
 }
 
-void MeterCommonImplementation::processFieldExtractors(Telegram *t) {
-  // Multiple dventries can be matched against a single wildcard FieldInfo.
-  std::map<FieldInfo *, std::set<DVEntry *>> founds;
+// Hash the difvif keys in telegram order. Two telegrams with the same
+// signature will match the field infos identically.
+static uint64_t layoutSignature(std::vector<DVEntry *> &entries) {
+  uint64_t hash = 14695981039346656037ULL; // FNV-1a
+  for (DVEntry *dve : entries) {
+    for (char c : dve->dif_vif_key.str()) {
+      hash = (hash ^ (uchar)c) * 1099511628211ULL;
+    }
+    hash = (hash ^ '/') * 1099511628211ULL;
+  }
+  return hash;
+}
 
-  // Sort the dv_entries based on their offset in the telegram.
-  // I.e. restore the ordering that was implicit in the telegram.
-  std::vector<DVEntry *> sorted_entries;
+MeterCommonImplementation::ExtractionPlan &
+MeterCommonImplementation::findExtractionPlan(std::vector<DVEntry *> &entries) {
+  uint64_t signature = layoutSignature(entries);
 
-  for (auto &p : t->dv_entries) {
-    sorted_entries.push_back(&p.second.second);
+  auto it = extraction_plans_.find(signature);
+  if (it != extraction_plans_.end() &&
+      it->second.num_entries == entries.size() &&
+      it->second.num_fields == field_infos_.size()) {
+    return it->second;
+  }
+
+  if (extraction_plans_.size() >= MAX_EXTRACTION_PLANS) {
+    // A meter with this many layouts is unusual, start over.
+    extraction_plans_.clear();
   }
-  sort(sorted_entries.begin(), sorted_entries.end(),
-       [](const DVEntry *a, const DVEntry *b) -> bool {
-         return a->offset < b->offset;
-       });
+
+  debug("(meters) building field extraction plan for layout %016llx\n",
+        (unsigned long long)signature);
+
+  ExtractionPlan &plan = extraction_plans_[signature];
+  plan.num_entries = entries.size();
+  plan.num_fields = field_infos_.size();
+  plan.steps.clear();
+  plan.field_found.assign(field_infos_.size(), false);
 
   // Now go through each field_info defined by the driver.
-  for (FieldInfo &fi : field_infos_) {
+  for (size_t f = 0; f < field_infos_.size(); ++f) {
+    FieldInfo &fi = field_infos_[f];
     int current_match_nr = 0;
 
     if (!fi.hasMatcher()) {
@@ -857,47 +932,61 @@ void MeterCommonImplementation::processFieldExtractors(Telegram *t) {
 
     // Iterate through dv_entries in the telegram in the same order the telegram
     // presented them.
-    for (DVEntry *dve : sorted_entries) {
-      if (fi.hasMatcher() && fi.matches(dve)) {
-        current_match_nr++;
-        if (fi.matcher().index_nr != IndexNr(current_match_nr) &&
-            !fi.matcher().expectedToMatchAgainstMultipleEntries()) {
-          // This field info did match, but requires another index nr!
-          // Increment the current index nr and look for the next match.
-        } else if (founds[&fi].count(dve) == 0 ||
-                   fi.matcher().expectedToMatchAgainstMultipleEntries()) {
-          debug("(meters) using field info %s(%s)[%d] to extract %s at offset "
-                "%d\n",
-                fi.vname().c_str(), toString(fi.xuantity()), fi.index(),
-                dve->dif_vif_key.str().c_str(), dve->offset);
-
-          dve->addFieldInfo(&fi);
-          fi.performExtraction(this, t, dve);
-          founds[&fi].insert(dve);
-        } else {
-          std::set<DVEntry *> old = founds[&fi];
-          std::string olds;
-          for (DVEntry *dve : old) {
-            olds += std::to_string(dve->offset) + ",";
-          }
-          olds.pop_back();
-
-          verbose("(meter) while processing field extractors ignoring dventry "
-                  "%s at offset %d matching since "
-                  "field %s was already matched against offsets %s !\n",
-                  dve->dif_vif_key.str().c_str(), dve->offset,
-                  fi.vname().c_str(), olds.c_str());
-        }
+    for (size_t e = 0; e < entries.size(); ++e) {
+      if (!fi.matches(entries[e]))
+        continue;
+      current_match_nr++;
+      if (fi.matcher().index_nr != IndexNr(current_match_nr) &&
+          !fi.matcher().expectedToMatchAgainstMultipleEntries()) {
+        // This field info did match, but requires another index nr!
+        // Increment the current index nr and look for the next match.
+        continue;
       }
+      plan.steps.push_back({(uint16_t)f, (uint16_t)e});
+      plan.field_found[f] = true;
     }
   }
 
+  return plan;
+}
+
+void MeterCommonImplementation::processFieldExtractors(Telegram *t) {
+  // Sort the dv_entries based on their offset in the telegram.
+  // I.e. restore the ordering that was implicit in the telegram.
+  std::vector<DVEntry *> sorted_entries;
+  sorted_entries.reserve(t->dv_entries.size());
+
+  for (auto &p : t->dv_entries) {
+    sorted_entries.push_back(&p.second.second);
+  }
+  sort(sorted_entries.begin(), sorted_entries.end(),
+       [](const DVEntry *a, const DVEntry *b) -> bool {
+         return a->offset < b->offset;
+       });
+
+  // Multiple dventries can be matched against a single wildcard FieldInfo.
+  ExtractionPlan &plan = findExtractionPlan(sorted_entries);
+
+  for (const ExtractionStep &step : plan.steps) {
+    FieldInfo &fi = field_infos_[step.field];
+    DVEntry *dve = sorted_entries[step.entry];
+
+    debug("(meters) using field info %s(%s)[%d] to extract %s at offset "
+          "%d\n",
+          fi.vname().c_str(), toString(fi.xuantity()), fi.index(),
+          dve->dif_vif_key.str().c_str(), dve->offset);
+
+    dve->addFieldInfo(&fi);
+    fi.performExtraction(this, t, dve);
+  }
+
   // Iterate over the fields that has no matcher rule. Ie the field
   // itself does the searching and matching.
-  for (FieldInfo &fi : field_infos_) {
+  for (size_t f = 0; f < field_infos_.size(); ++f) {
+    FieldInfo &fi = field_infos_[f];
     if (!fi.hasMatcher()) {
       fi.performExtraction(this, t, NULL);
-    } else if (founds.count(&fi) == 0 &&
+    } else if (!plan.field_found[f] &&
                fi.printProperties().hasINCLUDETPLSTATUS()) {
       // This is a status field and it joins the tpl status but it also
       // has a potential dve match, which did not trigger. Now
@@ -919,12 +1008,11 @@ void MeterCommonImplementation::processFieldCalculators() {
 }
 
 std::string MeterCommonImplementation::getStatusField(FieldInfo *fi) {
-  std::string field_name_no_unit = fi->vname();
-  if (string_values_.count(field_name_no_unit) == 0) {
+  StringField &sf = stringSlot(fi);
+  if (sf.field_info == NULL) {
     return "null"; // This is translated to a real(non-std::string) null in the
                    // json.
   }
-  StringField &sf = string_values_[field_name_no_unit];
   std::string value = sf.value;
 
   // This is >THE< status field, only one is allowed.
@@ -956,18 +1044,78 @@ bool MeterCommonImplementation::hasProcessContent() {
   return has_process_content_;
 }
 
+void MeterCommonImplementation::setupValueSlots() {
+  // The field infos are all added when the meter is created, before any
+  // values are stored.
+  size_t n = field_infos_.size();
+  if (numeric_slot_of_field_.size() == n)
+    return;
+
+  numeric_slots_.assign(n, NumericField());
+  string_slots_.assign(n, StringField());
+  numeric_slot_of_field_.resize(n);
+  string_slot_of_field_.resize(n);
+  numeric_slot_by_name_.clear();
+  string_slot_by_name_.clear();
+
+  for (size_t i = 0; i < n; ++i) {
+    FieldInfo &fi = field_infos_[i];
+    numeric_slot_of_field_[i] =
+        numeric_slot_by_name_
+            .insert({std::pair<std::string, Unit>(fi.vname(), fi.displayUnit()),
+                     i})
+            .first->second;
+    string_slot_of_field_[i] =
+        string_slot_by_name_.insert({fi.vname(), i}).first->second;
+  }
+}
+
+NumericField &MeterCommonImplementation::numericSlot(FieldInfo *fi) {
+  setupValueSlots();
+  size_t i = fi - field_infos_.data();
+  assert(i < field_infos_.size());
+  return numeric_slots_[numeric_slot_of_field_[i]];
+}
+
+StringField &MeterCommonImplementation::stringSlot(FieldInfo *fi) {
+  setupValueSlots();
+  size_t i = fi - field_infos_.data();
+  assert(i < field_infos_.size());
+  return string_slots_[string_slot_of_field_[i]];
+}
+
+NumericField *
+MeterCommonImplementation::findNumericField(const std::string &vname, Unit u) {
+  setupValueSlots();
+  std::pair<std::string, Unit> key(vname, u);
+  auto s = numeric_slot_by_name_.find(key);
+  if (s != numeric_slot_by_name_.end()) {
+    NumericField &nf = numeric_slots_[s->second];
+    return nf.field_info != NULL ? &nf : NULL;
+  }
+  auto it = numeric_values_.find(key);
+  return it != numeric_values_.end() ? &it->second : NULL;
+}
+
 void MeterCommonImplementation::setNumericValue(FieldInfo *fi, DVEntry *dve,
                                                 Unit u, double v) {
-  std::string field_name_no_unit;
+  if (dve == NULL || fi->hasFixedName()) {
+    NumericField &nf = numericSlot(fi);
+    nf.unit = u;
+    nf.value = v;
+    nf.field_info = fi;
+    return;
+  }
 
-  if (dve == NULL) {
-    std::string field_name_no_unit = fi->vname();
-    numeric_values_[std::pair<std::string, Unit>(
-        field_name_no_unit, fi->displayUnit())] = NumericField(u, v, fi);
+  setupValueSlots();
+  std::pair<std::string, Unit> key(fi->generateFieldNameNoUnit(this, dve),
+                                   fi->displayUnit());
+  auto s = numeric_slot_by_name_.find(key);
+  if (s != numeric_slot_by_name_.end()) {
+    // The generated name happens to be the name of another field.
+    numeric_slots_[s->second] = NumericField(u, v, fi, *dve);
   } else {
-    field_name_no_unit = fi->generateFieldNameNoUnit(this, dve);
-    numeric_values_[std::pair<std::string, Unit>(
-        field_name_no_unit, fi->displayUnit())] = NumericField(u, v, fi, *dve);
+    numeric_values_[key] = NumericField(u, v, fi, *dve);
   }
 }
 
@@ -990,45 +1138,58 @@ bool MeterCommonImplementation::hasValue(FieldInfo *fi) {
 }
 
 bool MeterCommonImplementation::hasNumericValue(FieldInfo *fi) {
-  std::pair<std::string, Unit> key(fi->vname(), fi->displayUnit());
-
-  return numeric_values_.count(key) != 0;
+  return numericSlot(fi).field_info != NULL;
 }
 
 bool MeterCommonImplementation::hasStringValue(FieldInfo *fi) {
-  return string_values_.count(fi->vname()) != 0;
+  return stringSlot(fi).field_info != NULL;
 }
 
 double MeterCommonImplementation::getNumericValue(FieldInfo *fi, Unit to) {
-  std::string field_name_no_unit = fi->vname();
-  std::pair<std::string, Unit> key(field_name_no_unit, fi->displayUnit());
-  if (numeric_values_.count(key) == 0) {
+  NumericField &nf = numericSlot(fi);
+  if (nf.field_info == NULL) {
     return std::numeric_limits<double>::quiet_NaN(); // This is translated into
                                                      // a null in the json.
   }
-  NumericField &nf = numeric_values_[key];
   return convert(nf.value, nf.unit, to);
 }
 
+bool MeterCommonImplementation::peekNumericValue(FieldInfo *fi, double *v,
+                                                 Unit *u) {
+  NumericField &nf = numericSlot(fi);
+  if (nf.field_info == NULL)
+    return false;
+
+  *v = nf.value;
+  *u = nf.unit;
+  return true;
+}
+
 double MeterCommonImplementation::getNumericValue(std::string vname, Unit to) {
-  std::pair<std::string, Unit> key(vname, to);
-  if (numeric_values_.count(key) == 0) {
+  NumericField *nf = findNumericField(vname, to);
+  if (nf == NULL) {
     return std::numeric_limits<double>::quiet_NaN(); // This is translated into
                                                      // a null in the json.
   }
-  NumericField &nf = numeric_values_[key];
-  return convert(nf.value, nf.unit, to);
+  return convert(nf->value, nf->unit, to);
 }
 
 void MeterCommonImplementation::setStringValue(FieldInfo *fi, std::string v,
                                                DVEntry *dve) {
-  std::string field_name_no_unit;
+  if (dve == NULL || fi->hasFixedName()) {
+    StringField &sf = stringSlot(fi);
+    sf.value = std::move(v);
+    sf.field_info = fi;
+    return;
+  }
 
-  if (dve == NULL) {
-    std::string field_name_no_unit = fi->vname();
-    string_values_[field_name_no_unit] = StringField(v, fi);
+  setupValueSlots();
+  std::string field_name_no_unit = fi->generateFieldNameNoUnit(this, dve);
+  auto s = string_slot_by_name_.find(field_name_no_unit);
+  if (s != string_slot_by_name_.end()) {
+    // The generated name happens to be the name of another field.
+    string_slots_[s->second] = StringField(v, fi);
   } else {
-    field_name_no_unit = fi->generateFieldNameNoUnit(this, dve);
     string_values_[field_name_no_unit] = StringField(v, fi);
   }
 }
@@ -1047,12 +1208,11 @@ void MeterCommonImplementation::setStringValue(std::string vname, std::string v,
 }
 
 std::string MeterCommonImplementation::getStringValue(FieldInfo *fi) {
-  std::string field_name_no_unit = fi->vname();
-  if (string_values_.count(field_name_no_unit) == 0) {
+  StringField &sf = stringSlot(fi);
+  if (sf.field_info == NULL) {
     return "null"; // This is translated to a real(non-std::string) null in the
                    // json.
   }
-  StringField &sf = string_values_[field_name_no_unit];
   std::string value = sf.value;
 
   if (fi->printProperties().hasSTATUS()) {
@@ -1108,20 +1268,15 @@ MeterCommonImplementation::renderJsonOnlyDefaultUnit(std::string vname,
 std::string MeterCommonImplementation::debugValues() {
   std::string s;
 
-  for (auto &p : numeric_values_) {
-    std::string vname = p.first.first;
-    std::string us = unitToStringLowerCase(p.first.second);
-    NumericField &nf = p.second;
+  forEachNumericValue([&](const std::string &vname, Unit u, NumericField &nf) {
+    std::string us = unitToStringLowerCase(u);
 
     s += tostrprintf("%s_%s = %g\n", vname.c_str(), us.c_str(), nf.value);
-  }
-
-  for (auto &p : string_values_) {
-    std::string vname = p.first;
-    StringField &nf = p.second;
+  });
 
+  forEachStringValue([&](const std::string &vname, StringField &nf) {
     s += tostrprintf("%s = \"%s\"\n", vname.c_str(), nf.value.c_str());
-  }
+  });
 
   return s;
 }
@@ -1146,7 +1301,8 @@ FieldInfo::FieldInfo(
       set_numeric_value_override_(set_numeric_value_override),
       set_string_value_override_(set_string_value_override), lookup_(lookup),
       formula_(formula), field_name_(newStringInterpolator()),
-      valid_field_name_(field_name_->parse(m, vname)) {
+      valid_field_name_(field_name_->parse(m, vname)),
+      fixed_name_(valid_field_name_ && vname.find('{') == std::string::npos) {
   if (!valid_field_name_) {
     warning("(meter) field template \"%s\" could not be parsed!\n",
             vname.c_str());
@@ -1184,45 +1340,51 @@ std::string FieldInfo::generateFieldNameWithUnit(Meter *m, DVEntry *dve) {
 
 std::string FieldInfo::renderJson(Meter *m, DVEntry *dve) {
   std::string s;
+  JsonWriter w(&s, false);
+  writeJson(m, dve, &w);
+  return s;
+}
 
-  std::string display_unit_s = unitToStringLowerCase(displayUnit());
-  std::string field_name = generateFieldNameNoUnit(m, dve);
+void FieldInfo::writeJson(Meter *m, DVEntry *dve, JsonWriter *w) {
+  std::string generated_name;
+  if (!fixed_name_)
+    generated_name = generateFieldNameNoUnit(m, dve);
+  const std::string &field_name = fixed_name_ ? vname_ : generated_name;
 
   if (xuantity() == Quantity::Text) {
     std::string v = m->getStringValue(this);
+    w->key(field_name.c_str());
     if (v == "null") {
       // Yes, right now a meter cannot send a string value "something":"null" it
       // will be translated into "something":null in the json, indicating that
       // there is no value. This should not be a problem for now. Lets deal with
       // it when a meter decides to send "null" as its version string for
       // example.
-      s += "\"" + field_name + "\":null";
+      w->nullValue();
     } else {
       // Normally the string values are quoted in json. TODO quote the value
       // properly. A well crafted meter could send a version string with " and
       // break the json format.
-      s += "\"" + field_name + "\":\"" + v + "\"";
-    }
-  } else {
-    if (displayUnit() == Unit::DateLT) {
-      s += "\"" + field_name + "_" + display_unit_s + "\":\"" +
-           strdate(m->getNumericValue(field_name, Unit::DateLT)) + "\"";
-    } else if (displayUnit() == Unit::DateTimeLT) {
-      s += "\"" + field_name + "_" + display_unit_s + "\":\"" +
-           strdatetime(m->getNumericValue(field_name, Unit::DateTimeLT)) + "\"";
-    } else if (displayUnit() == Unit::DateTimeUTC) {
-      s += "\"" + field_name + "_" + display_unit_s + "\":\"" +
-           strTimestampUTC(m->getNumericValue(field_name, Unit::DateTimeUTC)) +
-           "\"";
-    } else {
-      // All numeric values.
-      s += "\"" + field_name + "_" + display_unit_s + "\":" +
-           valueToString(m->getNumericValue(field_name, displayUnit()),
-                         displayUnit());
+      w->stringValue(v);
     }
+    return;
   }
 
-  return s;
+  std::string display_unit_s = unitToStringLowerCase(displayUnit());
+  // A field with a fixed name is stored in its own slot.
+  double v = fixed_name_ ? m->getNumericValue(this, displayUnit())
+                         : m->getNumericValue(field_name, displayUnit());
+  w->key(field_name.c_str(), "_", display_unit_s.c_str());
+  if (displayUnit() == Unit::DateLT) {
+    w->stringValue(strdate(v));
+  } else if (displayUnit() == Unit::DateTimeLT) {
+    w->stringValue(strdatetime(v));
+  } else if (displayUnit() == Unit::DateTimeUTC) {
+    w->stringValue(strTimestampUTC(v));
+  } else {
+    // All numeric values.
+    w->numberValue(v);
+  }
 }
 
 void MeterCommonImplementation::createMeterEnv(
@@ -1272,95 +1434,72 @@ void MeterCommonImplementation::printMeter(
   }
 
   if (json) {
-    std::string indent = "";
-    std::string newline = "";
-
-    if (pretty_print_json) {
-      indent = "    ";
-      newline = "\n";
-    }
-
-    std::string s;
-    s += "{" + newline;
-    s += indent + "\"_\":\"telegram\"," + newline;
-    s += indent + "\"media\":\"" + media + "\"," + newline;
-    s += indent + "\"meter\":\"" + driverName().str() + "\"," + newline;
-    s += indent + "\"name\":\"" + name() + "\"," + newline;
-    s += indent + "\"id\":\"" + id + "\"," + newline;
-
-    // Iterate over the meter field infos...
-    std::map<FieldInfo *, std::set<DVEntry *>>
-        founds; // Multiple dventries can match to a single field info.
-    std::set<std::string> found_vnames;
-
-    for (auto &p : numeric_values_) {
-      std::string vname = p.first.first;
-      NumericField &nf = p.second;
+    // Reuse the capacity of the callers buffer.
+    json->clear();
+    JsonWriter w(json, pretty_print_json);
+    bool detailed = first && getDetailedFirst();
+
+    w.beginObject();
+    w.key("_");
+    w.stringValue("telegram");
+    w.key("media");
+    w.stringValue(media);
+    w.key("meter");
+    w.stringValue(driverName().str());
+    w.key("name");
+    w.stringValue(name_);
+    w.key("id");
+    w.stringValue(id);
+
+    forEachNumericValue([&](const std::string &, Unit, NumericField &nf) {
       if (nf.field_info->printProperties().hasHIDE())
-        continue;
+        return;
 
-      std::string out = nf.field_info->renderJson(this, &nf.dv_entry);
-      s += indent + out + "," + newline;
+      nf.field_info->writeJson(this, &nf.dv_entry, &w);
 
-      if (first && getDetailedFirst()) {
-        size_t pos = out.find("\":");
-        if (pos != std::string::npos) {
-          std::string rule = out.substr(0, pos) + "_field\":" +
-                             std::to_string(nf.field_info->index());
-          s += indent + rule + "," + newline;
-        }
+      if (detailed) {
+        w.repeatKey("_field");
+        w.integerValue(nf.field_info->index());
       }
-    }
-
-    for (auto &p : string_values_) {
-      std::string vname = p.first;
-      StringField &sf = p.second;
-      std::string out;
+    });
 
+    forEachStringValue([&](const std::string &vname, StringField &sf) {
       if (sf.field_info->printProperties().hasHIDE())
-        continue;
+        return;
+
+      w.key(vname.c_str());
       if (sf.field_info->printProperties().hasSTATUS()) {
-        std::string in = getStatusField(sf.field_info);
-        out = tostrprintf("\"%s\":\"%s\"", vname.c_str(), in.c_str());
-        s += indent + out + "," + newline;
+        w.stringValue(getStatusField(sf.field_info));
+      } else if (sf.value == "null") {
+        // The string "null" translates to actual json null.
+        w.nullValue();
       } else {
-        if (sf.value == "null") {
-          // The string "null" translates to actual json null.
-          out = tostrprintf("\"%s\":null", vname.c_str());
-          s += indent + out + "," + newline;
-        } else {
-          out = tostrprintf("\"%s\":\"%s\"", vname.c_str(), sf.value.c_str());
-          s += indent + out + "," + newline;
-        }
+        w.stringValue(sf.value);
       }
-      if (first && getDetailedFirst()) {
-        size_t pos = out.find("\":");
-        if (pos != std::string::npos) {
-          std::string rule = out.substr(0, pos) + "_field\":" +
-                             std::to_string(sf.field_info->index());
-          s += indent + rule + "," + newline;
-        }
+
+      if (detailed) {
+        w.repeatKey("_field");
+        w.integerValue(sf.field_info->index());
       }
-    }
-    s += indent + "\"timestamp\":\"" + datetimeOfUpdateRobot() + "\"";
+    });
+
+    w.key("timestamp");
+    w.stringValue(datetimeOfUpdateRobot());
 
     if (t->about.device != "") {
-      s += "," + newline;
-      s += indent + "\"device\":\"" + t->about.device + "\"," + newline;
-      s += indent + "\"rssi_dbm\":" + std::to_string(t->about.rssi_dbm);
+      w.key("device");
+      w.stringValue(t->about.device);
+      w.key("rssi_dbm");
+      w.integerValue(t->about.rssi_dbm);
     }
-    for (std::string extra_field : meterExtraConstantFields()) {
-      s += "," + newline;
-      s += indent + makeQuotedJson(extra_field);
+    for (const std::string &extra_field : meterExtraConstantFields()) {
+      w.constantField(extra_field);
     }
     if (extra_constant_fields)
-      for (std::string extra_field : *extra_constant_fields) {
-        s += "," + newline;
-        s += indent + makeQuotedJson(extra_field);
+      for (const std::string &extra_field : *extra_constant_fields) {
+        w.constantField(extra_field);
       }
-    s += newline;
-    s += "}";
-    *json = s;
+    w.endObject();
   }
 
   if (envs) {
@@ -1423,20 +1562,25 @@ ELLSecurityMode MeterCommonImplementation::expectedELLSecurityMode() {
 
 void detectMeterDrivers(int manufacturer, int media, int version,
                         std::vector<std::string> *drivers) {
-  for (DriverInfo *p : allDrivers()) {
-    if (p->detect(manufacturer, media, version)) {
-      drivers->push_back(p->name().str());
-    }
+  DriverRegistry &r = driverRegistry();
+  uint32_t key = detectKey(manufacturer, media, version);
+  DriverInfo *prev = NULL;
+  for (auto i = findDetect(r, manufacturer, media, version);
+       i != r.detects.end() && i->key == key; i++) {
+    if (i->di != prev)
+      drivers->push_back(i->di->name().str());
+    prev = i->di;
   }
 }
 
 bool isMeterDriverValid(DriverName driver_name, int manufacturer, int media,
                         int version) {
-  for (DriverInfo *p : allDrivers()) {
-    if (p->detect(manufacturer, media, version)) {
-      if (p->hasDriverName(driver_name))
-        return true;
-    }
+  DriverRegistry &r = driverRegistry();
+  uint32_t key = detectKey(manufacturer, media, version);
+  for (auto i = findDetect(r, manufacturer, media, version);
+       i != r.detects.end() && i->key == key; i++) {
+    if (i->di->hasDriverName(driver_name))
+      return true;
   }
 
   return false;
@@ -1447,13 +1591,8 @@ bool isMeterDriverReasonableForMedia(std::string driver_name, int media) {
     return false; // Skip converter meter side since they do not give any useful
                   // information.
 
-  for (DriverInfo *p : allDrivers()) {
-    if (p->name().str() == driver_name && p->isValidMedia(media)) {
-      return true;
-    }
-  }
-
-  return false;
+  DriverInfo *p = lookupDriver(driver_name);
+  return p != NULL && p->name().str() == driver_name && p->isValidMedia(media);
 }
 
 DriverInfo driver_unknown_;
@@ -1469,10 +1608,11 @@ DriverInfo pickMeterDriver(Telegram *t) {
     version = t->tpl_version;
   }
 
-  for (DriverInfo *p : allDrivers()) {
-    if (p->detect(manufacturer, media, version)) {
-      return *p;
-    }
+  DriverRegistry &r = driverRegistry();
+  auto i = findDetect(r, manufacturer, media, version);
+  if (i != r.detects.end() &&
+      i->key == detectKey(manufacturer, media, version)) {
+    return *i->di;
   }
 
   return driver_unknown_;
@@ -1482,6 +1622,12 @@ std::shared_ptr<Meter> createMeter(MeterInfo *mi) {
   std::shared_ptr<Meter> newm;
 
   const char *keymsg = (mi->key[0] == 0) ? "not-encrypted" : "encrypted";
+  std::string aesc = AddressExpression::concat(mi->address_expressions);
+
+  std::string phase_name = "meter " + mi->driver_name.str();
+  if (!aesc.empty())
+    phase_name += " " + aesc;
+  StartupPhaseScope phase(phase_name);
 
   DriverInfo *di = lookupDriver(mi->driver_name.str());
 
@@ -1497,7 +1643,6 @@ std::shared_ptr<Meter> createMeter(MeterInfo *mi) {
       newm->setSelectedFields(di->defaultFields());
     }
 
-    std::string aesc = AddressExpression::concat(mi->address_expressions);
     verbose("(meter) created %s %s %s %s\n", mi->name.c_str(),
             di->name().str().c_str(), aesc.c_str(), keymsg);
 
@@ -1576,6 +1721,7 @@ std::string MeterInfo::str() {
 
 bool MeterInfo::parse(std::string n, std::string d, std::string aes,
                       std::string k) {
+  StartupPhaseScope phase("meter info parse");
   clear();
 
   name = n;
@@ -1858,7 +2004,7 @@ bool FieldInfo::extractString(Meter *m, Telegram *t, DVEntry *dve) {
     dve->extractDate(&datetime);
     std::string extracted_device_date_time;
 
-    if (dve->value.size() == 12) {
+    if (dve->valueLength() == 6) {
       // A long date time sec + timezone field. TODO add timezone data.
       extracted_device_date_time = strdatetimesec(&datetime);
     } else {
@@ -1926,6 +2072,7 @@ bool checkFieldsEmpty(std::set<std::string> &fields, std::string driver_name) {
 
 bool MeterCommonImplementation::addOptionalLibraryFields(
     std::string field_names) {
+  StartupPhaseScope phase("library fields");
   std::set<std::string> fields = splitStringIntoSet(field_names, ',');
 
   if (checkIf(fields, "actuality_duration_s")) {
@@ -21,6 +21,7 @@
 #include "address.h"
 #include "dvparser.h"
 #include "formula.h"
+#include "json_writer.h"
 #include "translatebits.h"
 #include "units.h"
 #include "util.h"
@@ -159,6 +160,11 @@ struct DriverDetect {
   uchar version;
 };
 
+struct DriverInfo;
+typedef std::shared_ptr<Meter> (*DriverConstructor)(MeterInfo &mi,
+                                                    DriverInfo &di);
+typedef void (*DriverSetup)(DriverInfo &di);
+
 struct DriverInfo {
 private:
   DriverName name_; // auto, unknown, amiplus, lse_07_17, multical21 etc
@@ -168,8 +174,8 @@ private:
   Translate::Lookup
       mfct_tpl_status_bits_; // Translate any mfct specific bits in tpl status.
   MeterType type_;           // Water, Electricity etc.
-  std::function<std::shared_ptr<Meter>(MeterInfo &, DriverInfo &di)>
-      constructor_; // Invoke this to create an instance of the driver.
+  DriverConstructor constructor_ =
+      NULL; // Invoke this to create an instance of the driver.
   std::vector<DriverDetect> detect_;
   std::vector<std::string> default_fields_;
   int force_mfct_index_ =
@@ -188,10 +194,7 @@ public:
   }
   void addLinkMode(LinkMode lm) { linkmodes_.addLinkMode(lm); }
   void forceMfctIndex(int i) { force_mfct_index_ = i; }
-  void setConstructor(
-      std::function<std::shared_ptr<Meter>(MeterInfo &, DriverInfo &)> c) {
-    constructor_ = c;
-  }
+  void setConstructor(DriverConstructor c) { constructor_ = c; }
   void addDetection(uint16_t mfct, uchar type, uchar ver) {
     detect_.push_back({mfct, type, ver});
   }
@@ -199,7 +202,7 @@ public:
 
   std::vector<DriverDetect> &detect() { return detect_; }
 
-  DriverName name() { return name_; }
+  const DriverName &name() { return name_; }
   std::vector<DriverName> &nameAliases() { return name_aliases_; }
   bool hasDriverName(DriverName dn) {
     if (name_ == dn)
@@ -224,7 +227,8 @@ public:
   bool hasProcessContent() { return has_process_content_; }
 };
 
-bool registerDriver(std::function<void(DriverInfo &di)> setup);
+// Store the setup of a driver, it is invoked when a driver is first looked up.
+bool registerDriver(DriverSetup setup);
 
 // A driver registers itself from a file-scope static initializer, and nothing
 // references any symbol inside a driver_*.cpp. Once the sources are archived
@@ -323,6 +327,8 @@ struct FieldInfo {
 
   int index() { return index_; }
   std::string vname() { return vname_; }
+  // True if the field name is not a template expanded per dventry.
+  bool hasFixedName() { return fixed_name_; }
   Quantity xuantity() { return xuantity_; }
   Unit displayUnit() { return display_unit_; }
   VifScaling vifScaling() { return vif_scaling_; }
@@ -343,6 +349,7 @@ struct FieldInfo {
 
   std::string renderJsonOnlyDefaultUnit(Meter *m);
   std::string renderJson(Meter *m, DVEntry *dve);
+  void writeJson(Meter *m, DVEntry *dve, JsonWriter *w);
   std::string renderJsonText(Meter *m, DVEntry *dve);
   // Render the field name based on the actual field from the telegram.
   // A FieldInfo can be declared to handle any number of storage fields of a
@@ -404,6 +411,9 @@ private:
   // If the field name template could not be parsed.
   bool valid_field_name_{};
 
+  // If the generated field name is always the vname.
+  bool fixed_name_{};
+
   // If true then this field was fetched from the library.
   bool from_library_{};
 };
@@ -444,6 +454,9 @@ struct Meter {
                                double v) = 0;
   virtual double getNumericValue(std::string vname, Unit u) = 0;
   virtual double getNumericValue(FieldInfo *fi, Unit u) = 0;
+  // Fetch the value of a field whose name is not generated from the dventry,
+  // in the unit it was stored with. Returns false if there is no value yet.
+  virtual bool peekNumericValue(FieldInfo *fi, double *v, Unit *u) = 0;
   virtual void setStringValue(FieldInfo *fi, std::string v, DVEntry *dve) = 0;
   virtual void setStringValue(std::string vname, std::string v,
                               DVEntry *dve = NULL) = 0;
@@ -469,6 +482,15 @@ struct Meter {
                               std::vector<uchar> input_frame, bool simulated,
                               std::vector<Address> *addresses, bool *id_match,
                               Telegram *out_t = NULL) = 0;
+  // Same as above, but for a frame whose header has already been parsed once
+  // (Telegram::parseHeader) and is shared between all meters. Only a meter
+  // whose address expressions match runs the full parse and decryption with
+  // its keys. If out_t is given, the telegram is parsed straight into it, so
+  // it should be a fresh Telegram.
+  virtual bool handleTelegram(AboutTelegram &about, const Telegram &header,
+                              const std::vector<uchar> &input_frame,
+                              bool simulated, std::vector<Address> *addresses,
+                              bool *id_match, Telegram *out_t = NULL) = 0;
   virtual MeterKeys *meterKeys() = 0;
 
   virtual void addExtraCalculatedField(std::string ecf) = 0;
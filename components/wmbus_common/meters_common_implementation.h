@@ -40,8 +40,14 @@ struct NumericField {
   NumericField() {}
   NumericField(Unit u, double v, FieldInfo *f)
       : unit(u), value(v), field_info(f) {}
+  // Only the counters of dve are kept, they are all that is needed to name
+  // the field. Its value bytes are a view into the frame of the telegram.
   NumericField(Unit u, double v, FieldInfo *f, DVEntry &dve)
-      : unit(u), value(v), field_info(f), dv_entry(dve) {}
+      : unit(u), value(v), field_info(f) {
+    dv_entry.storage_nr = dve.storage_nr;
+    dv_entry.tariff_nr = dve.tariff_nr;
+    dv_entry.subunit_nr = dve.subunit_nr;
+  }
 };
 
 struct StringField {
@@ -176,6 +182,15 @@ protected:
   bool handleTelegram(AboutTelegram &about, std::vector<uchar> frame,
                       bool simulated, std::vector<Address> *addresses,
                       bool *id_match, Telegram *out_analyzed = NULL);
+  bool handleTelegram(AboutTelegram &about, const Telegram &header,
+                      const std::vector<uchar> &input_frame, bool simulated,
+                      std::vector<Address> *addresses, bool *id_match,
+                      Telegram *out_analyzed = NULL);
+  // Parse, decrypt and extract the fields of a telegram already known to be
+  // for this meter. The address is only used for logging.
+  bool handleMatchedTelegram(Telegram &t, Address &address,
+                             const std::vector<uchar> &input_frame,
+                             bool *id_match);
   void createMeterEnv(std::string id, std::vector<std::string> *envs,
                       std::vector<std::string>
                           *more_json); // Add this json "key"="value" strings.
@@ -205,6 +220,7 @@ protected:
   void setNumericValue(FieldInfo *fi, DVEntry *dve, Unit u, double v);
   double getNumericValue(std::string vname, Unit u);
   double getNumericValue(FieldInfo *fi, Unit u);
+  bool peekNumericValue(FieldInfo *fi, double *v, Unit *u);
   void setStringValue(std::string vname, std::string v, DVEntry *dve = NULL);
   void setStringValue(FieldInfo *fi, std::string v, DVEntry *dve);
   std::string getStringValue(FieldInfo *fi);
@@ -250,6 +266,37 @@ private:
   bool has_process_content_ = false;
   bool has_received_first_telegram_ = false;
 
+  // A meter sends the same difvif layout over and over again. The result of
+  // matching the field infos against a layout is therefore remembered as a
+  // list of steps: extract field_infos_[field] from the entry'th dventry
+  // in telegram order.
+  struct ExtractionStep {
+    uint16_t field;
+    uint16_t entry;
+  };
+  struct ExtractionPlan {
+    size_t num_entries{};
+    size_t num_fields{};
+    std::vector<ExtractionStep> steps;
+    std::vector<bool> field_found;
+  };
+  static const size_t MAX_EXTRACTION_PLANS = 8;
+  std::map<uint64_t, ExtractionPlan> extraction_plans_;
+
+  ExtractionPlan &findExtractionPlan(std::vector<DVEntry *> &entries);
+
+  void setupValueSlots();
+  NumericField &numericSlot(FieldInfo *fi);
+  StringField &stringSlot(FieldInfo *fi);
+  NumericField *findNumericField(const std::string &vname, Unit u);
+  // Visit the stored values in name order. The callback is a template
+  // parameter, so a capturing lambda is called without being wrapped in an
+  // allocated std::function.
+  // Numeric: cb(const std::string &vname, Unit u, NumericField &nf)
+  template <typename Callback> void forEachNumericValue(Callback cb);
+  // String: cb(const std::string &vname, StringField &sf)
+  template <typename Callback> void forEachStringValue(Callback cb);
+
 protected:
   std::vector<FieldInfo> field_infos_;
   // This is the number of fields in the driver, not counting the used library
@@ -262,13 +309,64 @@ protected:
   std::vector<std::string> selected_fields_;
   // Map difvif key to hex values from telegrams.
   std::map<std::string, std::pair<int, std::string>> hex_values_;
-  // Map field name+Unit to Numeric field which includes the value.
+  // The values of fields stored under their own vname live in slots
+  // parallel to field_infos_, so storing and fetching them needs no string
+  // handling. Fields with the same name (and unit) share the slot of the
+  // first such field.
+  std::vector<NumericField> numeric_slots_;
+  std::vector<StringField> string_slots_;
+  std::vector<size_t> numeric_slot_of_field_;
+  std::vector<size_t> string_slot_of_field_;
+  // Slot per name, also used to print the values in name order.
+  std::map<std::pair<std::string, Unit>, size_t> numeric_slot_by_name_;
+  std::map<std::string, size_t> string_slot_by_name_;
+  // Map field name+Unit to Numeric field which includes the value. Only for
+  // names generated from a dventry, like total_at_month_{storage_counter}.
   std::map<std::pair<std::string, Unit>, NumericField> numeric_values_;
-  // Map field name (at_date) to string value.
+  // Map generated field name (at_date) to string value.
   std::map<std::string, StringField> string_values_;
   // If the telegram ends with 0x1f then set this to true, and the poll
   // code will poll again with 0x7b instead of 0x5b.
   bool more_records_follow_;
 };
 
+template <typename Callback>
+void MeterCommonImplementation::forEachNumericValue(Callback cb) {
+  setupValueSlots();
+  // Merge the slots and the generated names, both are sorted on name.
+  auto s = numeric_slot_by_name_.begin();
+  auto g = numeric_values_.begin();
+  while (s != numeric_slot_by_name_.end() || g != numeric_values_.end()) {
+    if (g == numeric_values_.end() ||
+        (s != numeric_slot_by_name_.end() && s->first < g->first)) {
+      NumericField &nf = numeric_slots_[s->second];
+      if (nf.field_info != NULL)
+        cb(s->first.first, s->first.second, nf);
+      ++s;
+    } else {
+      cb(g->first.first, g->first.second, g->second);
+      ++g;
+    }
+  }
+}
+
+template <typename Callback>
+void MeterCommonImplementation::forEachStringValue(Callback cb) {
+  setupValueSlots();
+  auto s = string_slot_by_name_.begin();
+  auto g = string_values_.begin();
+  while (s != string_slot_by_name_.end() || g != string_values_.end()) {
+    if (g == string_values_.end() ||
+        (s != string_slot_by_name_.end() && s->first < g->first)) {
+      StringField &sf = string_slots_[s->second];
+      if (sf.field_info != NULL)
+        cb(s->first, sf);
+      ++s;
+    } else {
+      cb(g->first, g->second);
+      ++g;
+    }
+  }
+}
+
 #endif
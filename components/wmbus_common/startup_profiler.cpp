@@ -0,0 +1,90 @@
+// Records how long the steps of starting up take and how much heap they use.
+#include "startup_profiler.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#else
+#include <chrono>
+#include <malloc.h>
+#endif
+
+#ifdef ESP_PLATFORM
+static int64_t nowUs() { return esp_timer_get_time(); }
+
+static int64_t heapUsed() {
+  return -(int64_t)heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+}
+#else
+static const std::chrono::steady_clock::time_point program_start_ =
+    std::chrono::steady_clock::now();
+
+static int64_t nowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - program_start_)
+      .count();
+}
+
+static int64_t heapUsed() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+  return (int64_t)mallinfo2().uordblks;
+#else
+  return 0;
+#endif
+}
+#endif
+
+struct RunningPhase {
+  size_t index;
+  int64_t start_us;
+  int64_t heap_used;
+};
+
+static std::vector<StartupPhase> &phases() {
+  static std::vector<StartupPhase> p;
+  return p;
+}
+
+static std::vector<RunningPhase> &running() {
+  static std::vector<RunningPhase> r;
+  return r;
+}
+
+void startupPhaseBegin(const std::string &name) {
+  std::vector<StartupPhase> &p = phases();
+  int depth = (int)running().size();
+
+  // Look for the same phase among the earlier ones in the enclosing phase.
+  size_t index = p.size();
+  for (size_t i = p.size(); i > 0; i--) {
+    StartupPhase &sp = p[i - 1];
+    if (sp.depth < depth)
+      break;
+    if (sp.depth == depth && sp.name == name) {
+      index = i - 1;
+      break;
+    }
+  }
+
+  int64_t now = nowUs();
+  if (index == p.size())
+    p.push_back({name, depth, 0, now, 0, 0});
+  p[index].count++;
+
+  running().push_back({index, now, heapUsed()});
+}
+
+void startupPhaseEnd() {
+  std::vector<RunningPhase> &r = running();
+  if (r.empty())
+    return;
+
+  RunningPhase rp = r.back();
+  r.pop_back();
+
+  StartupPhase &sp = phases()[rp.index];
+  sp.duration_us += nowUs() - rp.start_us;
+  sp.heap_bytes += heapUsed() - rp.heap_used;
+}
+
+const std::vector<StartupPhase> &startupPhases() { return phases(); }
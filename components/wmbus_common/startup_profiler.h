@@ -0,0 +1,33 @@
+// Records how long the steps of starting up take and how much heap they use.
+#ifndef STARTUP_PROFILER_H
+#define STARTUP_PROFILER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct StartupPhase {
+  std::string name;
+  // A phase begun while another one is running is nested in it.
+  int depth;
+  // A phase begun again, at the same place, is added to the first one.
+  uint32_t count;
+  // Microseconds since boot, or since the program started on the host.
+  int64_t start_us;
+  int64_t duration_us;
+  // Heap allocated during the phase, negative if more was freed.
+  int64_t heap_bytes;
+};
+
+void startupPhaseBegin(const std::string &name);
+void startupPhaseEnd();
+// The phases in the order they were begun.
+const std::vector<StartupPhase> &startupPhases();
+
+// Measures a phase until the end of the scope.
+struct StartupPhaseScope {
+  StartupPhaseScope(const std::string &name) { startupPhaseBegin(name); }
+  ~StartupPhaseScope() { startupPhaseEnd(); }
+};
+
+#endif
@@ -22,60 +22,61 @@
 #include <math.h>
 #include <string.h>
 
+// A value is converted as vto = vfrom * scale + offset.
 #define LIST_OF_CONVERSIONS                                                    \
-  X(Second, Minute, { vto = vfrom / 60.0; })                                   \
-  X(Minute, Second, { vto = vfrom * 60.0; })                                   \
-  X(Second, Hour, { vto = vfrom / 3600.0; })                                   \
-  X(Hour, Second, { vto = vfrom * 3600.0; })                                   \
-  X(Year, Second, { vto = vfrom * 3600.0 * 24.0 * 365.2425; })                 \
-  X(Second, Year, { vto = vfrom / 3600.0 / 24.0 / 365.2425; })                 \
-  X(Minute, Hour, { vto = vfrom / 60.0; })                                     \
-  X(Hour, Minute, { vto = vfrom * 60.0; })                                     \
-  X(Minute, Year, { vto = vfrom / 60.0 / 24.0 / 365.2425; })                   \
-  X(Year, Minute, { vto = vfrom * 60.0 * 24.0 * 365.2425; })                   \
-  X(Hour, Year, { vto = vfrom / 24.0 / 365.2425; })                            \
-  X(Year, Hour, { vto = vfrom * 24.0 * 365.2425; })                            \
-  X(Hour, Day, { vto = vfrom / 24.0; })                                        \
-  X(Day, Hour, { vto = vfrom * 24.0; })                                        \
-  X(Day, Year, { vto = vfrom / 365.2425; })                                    \
-  X(Year, Day, { vto = vfrom * 365.2425; })                                    \
-  X(WH, KWH, { vto = vfrom / 1000.0; })                                        \
-  X(KWH, GJ, { vto = vfrom * 0.0036; })                                        \
-  X(KWH, MJ, { vto = vfrom * 0.0036 * 1000.0; })                               \
-  X(GJ, KWH, { vto = vfrom / 0.0036; })                                        \
-  X(MJ, GJ, { vto = vfrom / 1000.0; })                                         \
-  X(MJ, KWH, { vto = vfrom / 1000.0 / 0.0036; })                               \
-  X(GJ, MJ, { vto = vfrom * 1000.0; })                                         \
-  X(W, KW, { vto = vfrom / 1000.0; })                                          \
-  X(JH, W, { vto = vfrom / 3600.0; })                                          \
-  X(W, JH, { vto = vfrom * 3600.0; })                                          \
-  X(MJH, KW, { vto = vfrom / 1000.0 / 0.0036; })                               \
-  X(KW, MJH, { vto = vfrom * 0.0036 * 1000.0; })                               \
-  X(M3, L, { vto = vfrom * 1000.0; })                                          \
-  X(M3H, LH, { vto = vfrom * 1000.0; })                                        \
-  X(L, M3, { vto = vfrom / 1000.0; })                                          \
-  X(LH, M3H, { vto = vfrom / 1000.0; })                                        \
-  X(C, K, { vto = vfrom + 273.15; })                                           \
-  X(K, C, { vto = vfrom - 273.15; })                                           \
-  X(C, F, { vto = (vfrom * 9.0 / 5.0) + 32.0; })                               \
-  X(F, C, { vto = (vfrom - 32) * 5.0 / 9.0; })                                 \
-  X(PA, BAR, { vto = vfrom / 100000.0; })                                      \
-  X(BAR, PA, { vto = vfrom * 100000.0; })                                      \
-  X(COUNTER, FACTOR, { vto = vfrom; })                                         \
-  X(FACTOR, COUNTER, { vto = vfrom; })                                         \
-  X(COUNTER, NUMBER, { vto = vfrom; })                                         \
-  X(NUMBER, COUNTER, { vto = vfrom; })                                         \
-  X(FACTOR, NUMBER, { vto = vfrom; })                                          \
-  X(NUMBER, FACTOR, { vto = vfrom; })                                          \
-  X(PERCENTAGE, NUMBER, { vto = vfrom; })                                      \
-  X(NUMBER, PERCENTAGE, { vto = vfrom; })                                      \
-  X(UnixTimestamp, DateTimeLT, { vto = vfrom; })                               \
-  X(DateTimeLT, UnixTimestamp, { vto = vfrom; })                               \
-  X(DateLT, UnixTimestamp, { vto = vfrom; })                                   \
-  X(DateTimeLT, DateLT, { vto = vfrom; })                                      \
-  X(DateLT, DateTimeLT, { vto = vfrom; })                                      \
-  X(DEGREE, RADIAN, { vto = vfrom * M_PI / 180.0; })                           \
-  X(RADIAN, DEGREE, { vto = vfrom * 180.0 / M_PI; })
+  X(Second, Minute, 1.0 / 60.0, 0.0)                                           \
+  X(Minute, Second, 60.0, 0.0)                                                 \
+  X(Second, Hour, 1.0 / 3600.0, 0.0)                                           \
+  X(Hour, Second, 3600.0, 0.0)                                                 \
+  X(Year, Second, 3600.0 * 24.0 * 365.2425, 0.0)                               \
+  X(Second, Year, 1.0 / (3600.0 * 24.0 * 365.2425), 0.0)                       \
+  X(Minute, Hour, 1.0 / 60.0, 0.0)                                             \
+  X(Hour, Minute, 60.0, 0.0)                                                   \
+  X(Minute, Year, 1.0 / (60.0 * 24.0 * 365.2425), 0.0)                         \
+  X(Year, Minute, 60.0 * 24.0 * 365.2425, 0.0)                                 \
+  X(Hour, Year, 1.0 / (24.0 * 365.2425), 0.0)                                  \
+  X(Year, Hour, 24.0 * 365.2425, 0.0)                                          \
+  X(Hour, Day, 1.0 / 24.0, 0.0)                                                \
+  X(Day, Hour, 24.0, 0.0)                                                      \
+  X(Day, Year, 1.0 / 365.2425, 0.0)                                            \
+  X(Year, Day, 365.2425, 0.0)                                                  \
+  X(WH, KWH, 1.0 / 1000.0, 0.0)                                                \
+  X(KWH, GJ, 0.0036, 0.0)                                                      \
+  X(KWH, MJ, 0.0036 * 1000.0, 0.0)                                             \
+  X(GJ, KWH, 1.0 / 0.0036, 0.0)                                                \
+  X(MJ, GJ, 1.0 / 1000.0, 0.0)                                                 \
+  X(MJ, KWH, 1.0 / 1000.0 / 0.0036, 0.0)                                       \
+  X(GJ, MJ, 1000.0, 0.0)                                                       \
+  X(W, KW, 1.0 / 1000.0, 0.0)                                                  \
+  X(JH, W, 1.0 / 3600.0, 0.0)                                                  \
+  X(W, JH, 3600.0, 0.0)                                                        \
+  X(MJH, KW, 1.0 / 1000.0 / 0.0036, 0.0)                                       \
+  X(KW, MJH, 0.0036 * 1000.0, 0.0)                                             \
+  X(M3, L, 1000.0, 0.0)                                                        \
+  X(M3H, LH, 1000.0, 0.0)                                                      \
+  X(L, M3, 1.0 / 1000.0, 0.0)                                                  \
+  X(LH, M3H, 1.0 / 1000.0, 0.0)                                                \
+  X(C, K, 1.0, 273.15)                                                         \
+  X(K, C, 1.0, -273.15)                                                        \
+  X(C, F, 9.0 / 5.0, 32.0)                                                     \
+  X(F, C, 5.0 / 9.0, -32.0 * 5.0 / 9.0)                                        \
+  X(PA, BAR, 1.0 / 100000.0, 0.0)                                              \
+  X(BAR, PA, 100000.0, 0.0)                                                    \
+  X(COUNTER, FACTOR, 1.0, 0.0)                                                 \
+  X(FACTOR, COUNTER, 1.0, 0.0)                                                 \
+  X(COUNTER, NUMBER, 1.0, 0.0)                                                 \
+  X(NUMBER, COUNTER, 1.0, 0.0)                                                 \
+  X(FACTOR, NUMBER, 1.0, 0.0)                                                  \
+  X(NUMBER, FACTOR, 1.0, 0.0)                                                  \
+  X(PERCENTAGE, NUMBER, 1.0, 0.0)                                              \
+  X(NUMBER, PERCENTAGE, 1.0, 0.0)                                              \
+  X(UnixTimestamp, DateTimeLT, 1.0, 0.0)                                       \
+  X(DateTimeLT, UnixTimestamp, 1.0, 0.0)                                       \
+  X(DateLT, UnixTimestamp, 1.0, 0.0)                                           \
+  X(DateTimeLT, DateLT, 1.0, 0.0)                                              \
+  X(DateLT, DateTimeLT, 1.0, 0.0)                                              \
+  X(DEGREE, RADIAN, M_PI / 180.0, 0.0)                                         \
+  X(RADIAN, DEGREE, 180.0 / M_PI, 0.0)
 
 #define LIST_OF_SI_CONVERSIONS                                                 \
   X(Second, 1.0, SIExp().s(1))                                                 \
@@ -169,30 +170,61 @@ bool overrideConversion(Unit from, Unit to) {
   return false;
 }
 
-bool canConvert(Unit ufrom, Unit uto) {
-  if (ufrom == uto)
-    return true;
-#define X(from, to, code)                                                      \
-  if (Unit::from == ufrom && Unit::to == uto)                                  \
-    return true;
-  LIST_OF_CONVERSIONS
+struct UnitConversion {
+  double scale;
+  double offset;
+};
+
+// Entry 0 is used when the units are the same and entry 1 when the units
+// cannot be converted.
+static constexpr uint8_t SAME_UNIT = 0;
+static constexpr uint8_t NO_CONVERSION = 1;
+
+static constexpr UnitConversion unit_conversions[] = {
+    {1.0, 0.0},
+    {std::numeric_limits<double>::quiet_NaN(),
+     std::numeric_limits<double>::quiet_NaN()},
+#define X(from, to, scale, offset) {scale, offset},
+    LIST_OF_CONVERSIONS
 #undef X
-  return false;
-}
+};
 
-double convert(double vfrom, Unit ufrom, Unit uto) {
-  double vto = -4711.0;
-  if (ufrom == uto) {
-    { vto = vfrom; }
-    return vto;
-  }
+static_assert(sizeof(unit_conversions) / sizeof(unit_conversions[0]) <= 256,
+              "Too many unit conversions for the uint8_t index!");
 
-#define X(from, to, code)                                                      \
-  if (Unit::from == ufrom && Unit::to == uto) {                                \
-    code return vto;                                                           \
-  }
+static constexpr size_t NUM_UNITS = (size_t)Unit::Unknown + 1;
+
+// For every pair of units the index of their entry in unit_conversions.
+struct UnitConversionTable {
+  uint8_t index[NUM_UNITS][NUM_UNITS];
+};
+
+static constexpr UnitConversionTable buildUnitConversionTable() {
+  UnitConversionTable t{};
+  for (size_t from = 0; from < NUM_UNITS; from++)
+    for (size_t to = 0; to < NUM_UNITS; to++)
+      t.index[from][to] = from == to ? SAME_UNIT : NO_CONVERSION;
+
+  uint8_t i = NO_CONVERSION + 1;
+#define X(from, to, scale, offset)                                             \
+  t.index[(size_t)Unit::from][(size_t)Unit::to] = i++;
   LIST_OF_CONVERSIONS
 #undef X
+  return t;
+}
+
+static constexpr UnitConversionTable unit_conversion_table =
+    buildUnitConversionTable();
+
+bool canConvert(Unit ufrom, Unit uto) {
+  return unit_conversion_table.index[(size_t)ufrom][(size_t)uto] !=
+         NO_CONVERSION;
+}
+
+double convert(double vfrom, Unit ufrom, Unit uto) {
+  uint8_t i = unit_conversion_table.index[(size_t)ufrom][(size_t)uto];
+  if (i != NO_CONVERSION)
+    return vfrom * unit_conversions[i].scale + unit_conversions[i].offset;
 
   std::string from = unitToStringHR(ufrom);
   std::string to = unitToStringHR(uto);
@@ -263,6 +295,37 @@ bool SIUnit::convertTo(double left, const SIUnit &out_siunit,
   return false;
 }
 
+bool SIUnit::affineTo(const SIUnit &out_siunit, double *out_scale,
+                      double *out_offset) const {
+  if (exp() == out_siunit.exp()) {
+    *out_scale = scale_ / out_siunit.scale_;
+    *out_offset = 0.0;
+    return true;
+  }
+
+  if (isKCF(exp()) && isKCF(out_siunit.exp())) {
+    double from_scale{};
+    double from_offset{};
+
+    getScaleOffset(exp(), &from_scale, &from_offset);
+    from_scale *= scale_;
+
+    double to_offset{};
+    double to_scale{};
+
+    getScaleOffset(out_siunit.exp(), &to_scale, &to_offset);
+    to_scale *= out_siunit.scale();
+
+    *out_scale = from_scale / to_scale;
+    *out_offset = from_offset * from_scale / to_scale - to_offset;
+    return true;
+  }
+
+  *out_scale = std::numeric_limits<double>::quiet_NaN();
+  *out_offset = std::numeric_limits<double>::quiet_NaN();
+  return false;
+}
+
 bool forbidden_op(MathOp op, const SIExp &a, const SIExp &b) {
   // Two unix timestamps cannot be added together. They can be subtracted
   // though!
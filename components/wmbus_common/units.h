@@ -315,6 +315,10 @@ struct SIUnit {
   // Convert value from this unit to another unit and store it in out. Return
   // false if conversion is impossible!
   bool convertTo(double left, const SIUnit &out_siunit, double *out) const;
+  // Get the scale and offset that convert a value from this unit to another
+  // unit as value*scale+offset. Return false if conversion is impossible!
+  bool affineTo(const SIUnit &out_siunit, double *out_scale,
+                double *out_offset) const;
   // Do a math op. Store the resulting unit and value into the destination
   // pointers. Return false if the addion cannot be performed.
   bool mathOpTo(MathOp op, double left, double right,
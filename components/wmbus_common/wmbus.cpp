@@ -906,6 +906,25 @@ void Telegram::addExplanationAndIncrementPos(std::vector<uchar>::iterator &pos,
   pos += len;
 }
 
+void Telegram::addValueExplanationAndIncrementPos(
+    std::vector<uchar>::iterator &pos, int len) {
+  Explanation e(parsed.size(), len, "", KindOfData::CONTENT,
+                Understanding::NONE);
+  e.hex_prefix = true;
+  explanations.push_back(e);
+  parsed.insert(parsed.end(), pos, pos + len);
+  pos += len;
+}
+
+void Telegram::renderValueExplanations() {
+  for (auto &e : explanations) {
+    if (!e.hex_prefix)
+      continue;
+    e.info = bin2hex(parsed, e.pos, e.len) + e.info;
+    e.hex_prefix = false;
+  }
+}
+
 void Telegram::setExplanation(std::vector<uchar>::iterator &pos, int len,
                               KindOfData k, Understanding u, const char *fmt,
                               ...) {
@@ -1237,7 +1256,8 @@ bool Telegram::parseELL(std::vector<uchar>::iterator &pos) {
 
     if (ell_sec_mode == ELLSecurityMode::AES_CTR) {
       if (meter_keys) {
-        decrypt_ELL_AES_CTR(this, frame, pos, meter_keys->confidentiality_key);
+        decrypt_ELL_AES_CTR(this, frame, pos,
+                            meter_keys->confidentialityContext());
         // Actually this ctr decryption always succeeds, if wrong key, it will
         // decrypt to garbage.
       }
@@ -1564,8 +1584,12 @@ bool Telegram::parseTPLConfig(std::vector<uchar>::iterator &pos) {
         debug("(wmbus) no key, thus cannot execute kdf.\n");
         return false;
       }
-      AES_CMAC(safeButUnsafeVectorPtr(meter_keys->confidentiality_key),
-               safeButUnsafeVectorPtr(input), 16, safeButUnsafeVectorPtr(mac));
+      if (!AES_CMAC(meter_keys->confidentialityContext(),
+                    safeButUnsafeVectorPtr(input), 16,
+                    safeButUnsafeVectorPtr(mac))) {
+        debug("(wmbus) no key, thus cannot execute kdf.\n");
+        return false;
+      }
       std::string s = bin2hex(mac);
       debug("(wmbus) ephemereal Kenc %s\n", s.c_str());
       tpl_generated_key.clear();
@@ -1575,8 +1599,12 @@ bool Telegram::parseTPLConfig(std::vector<uchar>::iterator &pos) {
       mac.clear();
       mac.resize(16);
       debugPayload("(wmbus) input to kdf for mac", input);
-      AES_CMAC(safeButUnsafeVectorPtr(meter_keys->confidentiality_key),
-               safeButUnsafeVectorPtr(input), 16, safeButUnsafeVectorPtr(mac));
+      if (!AES_CMAC(meter_keys->confidentialityContext(),
+                    safeButUnsafeVectorPtr(input), 16,
+                    safeButUnsafeVectorPtr(mac))) {
+        debug("(wmbus) no key, thus cannot execute kdf.\n");
+        return false;
+      }
       s = bin2hex(mac);
       debug("(wmbus) ephemereal Kmac %s\n", s.c_str());
       tpl_generated_mac_key.clear();
@@ -1682,8 +1710,9 @@ bool Telegram::checkMAC(std::vector<uchar> &frame,
   input.insert(input.end(), from, to);
   std::string s = bin2hex(input);
   debug("(wmbus) input to mac %s\n", s.c_str());
-  AES_CMAC(safeButUnsafeVectorPtr(mackey), safeButUnsafeVectorPtr(input),
-           input.size(), safeButUnsafeVectorPtr(mac));
+  if (!AES_CMAC(safeButUnsafeVectorPtr(mackey), safeButUnsafeVectorPtr(input),
+                input.size(), safeButUnsafeVectorPtr(mac)))
+    return false;
   std::string calculated = bin2hex(mac);
   debug("(wmbus) calculated mac %s\n", calculated.c_str());
   std::string received = bin2hex(inmac);
@@ -1741,8 +1770,8 @@ bool Telegram::potentiallyDecrypt(std::vector<uchar>::iterator &pos) {
     int num_not_encrypted_at_end = 0;
 
     bool ok = decrypt_TPL_AES_CBC_IV(
-        this, frame, pos, meter_keys->confidentiality_key, &num_encrypted_bytes,
-        &num_not_encrypted_at_end);
+        this, frame, pos, meter_keys->confidentialityContext(),
+        &num_encrypted_bytes, &num_not_encrypted_at_end);
     if (!ok) {
       // No key supplied.
       std::string info = bin2hex(pos, frame.end(), num_encrypted_bytes);
@@ -2105,7 +2134,7 @@ void Telegram::preProcess() {
   }
 }
 
-bool Telegram::parse(std::vector<uchar> &input_frame, MeterKeys *mk,
+bool Telegram::parse(const std::vector<uchar> &input_frame, MeterKeys *mk,
                      bool warn) {
   switch (about.type) {
   case FrameType::WMBUS:
@@ -2119,7 +2148,7 @@ bool Telegram::parse(std::vector<uchar> &input_frame, MeterKeys *mk,
   return false;
 }
 
-bool Telegram::parseHeader(std::vector<uchar> &input_frame) {
+bool Telegram::parseHeader(const std::vector<uchar> &input_frame) {
   switch (about.type) {
   case FrameType::WMBUS:
     return parseWMBUSHeader(input_frame);
@@ -2132,7 +2161,7 @@ bool Telegram::parseHeader(std::vector<uchar> &input_frame) {
   return false;
 }
 
-bool Telegram::parseWMBUSHeader(std::vector<uchar> &input_frame) {
+bool Telegram::parseWMBUSHeader(const std::vector<uchar> &input_frame) {
   assert(about.type == FrameType::WMBUS);
 
   bool ok;
@@ -2178,8 +2207,8 @@ bool Telegram::parseWMBUSHeader(std::vector<uchar> &input_frame) {
   return true;
 }
 
-bool Telegram::parseWMBUS(std::vector<uchar> &input_frame, MeterKeys *mk,
-                          bool warn) {
+bool Telegram::parseWMBUS(const std::vector<uchar> &input_frame,
+                          MeterKeys *mk, bool warn) {
   assert(about.type == FrameType::WMBUS);
 
   parser_warns_ = warn;
@@ -2263,7 +2292,7 @@ bool Telegram::parseWMBUS(std::vector<uchar> &input_frame, MeterKeys *mk,
   return true;
 }
 
-bool Telegram::parseMBUSHeader(std::vector<uchar> &input_frame) {
+bool Telegram::parseMBUSHeader(const std::vector<uchar> &input_frame) {
   assert(about.type == FrameType::MBUS);
 
   bool ok;
@@ -2286,7 +2315,7 @@ bool Telegram::parseMBUSHeader(std::vector<uchar> &input_frame) {
   return true;
 }
 
-bool Telegram::parseMBUS(std::vector<uchar> &input_frame, MeterKeys *mk,
+bool Telegram::parseMBUS(const std::vector<uchar> &input_frame, MeterKeys *mk,
                          bool warn) {
   assert(about.type == FrameType::MBUS);
 
@@ -2315,13 +2344,13 @@ bool Telegram::parseMBUS(std::vector<uchar> &input_frame, MeterKeys *mk,
   return true;
 }
 
-bool Telegram::parseHANHeader(std::vector<uchar> &input_frame) {
+bool Telegram::parseHANHeader(const std::vector<uchar> &input_frame) {
   assert(about.type == FrameType::HAN);
 
   return false;
 }
 
-bool Telegram::parseHAN(std::vector<uchar> &input_frame, MeterKeys *mk,
+bool Telegram::parseHAN(const std::vector<uchar> &input_frame, MeterKeys *mk,
                         bool warn) {
   assert(about.type == FrameType::HAN);
 
@@ -2329,6 +2358,7 @@ bool Telegram::parseHAN(std::vector<uchar> &input_frame, MeterKeys *mk,
 }
 
 void Telegram::explainParse(std::string intro, int from) {
+  renderValueExplanations();
   for (auto &p : explanations) {
     // Protocol or content?
     const char *c = p.kind == KindOfData::PROTOCOL ? " " : "C";
@@ -2426,6 +2456,7 @@ std::string Telegram::analyzeParse(OutputFormat format, int *content_length,
   int u = 0;
   int l = 0;
 
+  renderValueExplanations();
   sort(explanations.begin(), explanations.end(),
        [](const Explanation &a, const Explanation &b) -> bool {
          return a.pos < b.pos;
@@ -4860,8 +4891,6 @@ bool trimCRCsFrameFormatAInternal(std::vector<uchar> &payload,
     debugPayload("(wmbus) trimming frame A", payload);
   }
 
-  std::vector<uchar> out;
-
   uint16_t calc_crc = crc16_EN13757(safeButUnsafeVectorPtr(payload), 10);
   uint16_t check_crc = payload[10] << 8 | payload[11];
 
@@ -4873,7 +4902,6 @@ bool trimCRCsFrameFormatAInternal(std::vector<uchar> &payload,
     }
     return false;
   }
-  out.insert(out.end(), payload.begin(), payload.begin() + 10);
   if (!fail_is_ok) {
     debug("(wmbus) ff a dll crc 0-%zu %04x ok\n", 10 - 1, calc_crc);
   }
@@ -4891,7 +4919,6 @@ bool trimCRCsFrameFormatAInternal(std::vector<uchar> &payload,
       }
       return false;
     }
-    out.insert(out.end(), payload.begin() + pos, payload.begin() + pos + 16);
     if (!fail_is_ok) {
       debug("(wmbus) ff a dll crc mid %zu-%zu %04x ok\n", pos, to - 1,
             calc_crc);
@@ -4911,19 +4938,30 @@ bool trimCRCsFrameFormatAInternal(std::vector<uchar> &payload,
       }
       return false;
     }
-    out.insert(out.end(), payload.begin() + pos, payload.begin() + tto);
     if (!fail_is_ok) {
       debug("(wmbus) ff a dll crc final %zu-%zu %04x ok\n", pos, tto - 1,
             calc_crc);
     }
   }
 
-  debugPayload("(wmbus) trimming frame A", payload);
+  // All crcs are verified, now move the blocks down over the crcs. Doing
+  // this only after the checks leaves the payload untouched when a check
+  // fails, removeAnyDLLCRCs then tries frame format B on it.
+  uchar *data = safeButUnsafeVectorPtr(payload);
+  size_t out = 10;
+  for (pos = 12; pos + 18 <= len; pos += 18) {
+    memmove(data + out, data + pos, 16);
+    out += 16;
+  }
+  if (pos < len - 2) {
+    memmove(data + out, data + pos, len - 2 - pos);
+    out += len - 2 - pos;
+  }
+  payload.resize(out);
 
-  out[0] = out.size() - 1;
-  size_t new_len = out[0] + 1;
-  size_t old_size = payload.size();
-  payload = out;
+  payload[0] = out - 1;
+  size_t new_len = payload[0] + 1;
+  size_t old_size = len;
   size_t new_size = payload.size();
 
   debug("(wmbus) trimmed %zu dll crc bytes from frame a and ignored %zu suffix "
@@ -4948,7 +4986,6 @@ bool trimCRCsFrameFormatBInternal(std::vector<uchar> &payload,
     debugPayload("(wmbus) trimming frame B", payload);
   }
 
-  std::vector<uchar> out;
   size_t crc1_pos, crc2_pos;
   if (len <= 128) {
     crc1_pos = len - 2;
@@ -4972,7 +5009,6 @@ bool trimCRCsFrameFormatBInternal(std::vector<uchar> &payload,
     return false;
   }
 
-  out.insert(out.end(), payload.begin(), payload.begin() + crc1_pos);
   if (!fail_is_ok) {
     debug("(wmbus) ff b dll crc first 0-%zu %04x ok\n", crc1_pos, calc_crc);
   }
@@ -4992,20 +5028,24 @@ bool trimCRCsFrameFormatBInternal(std::vector<uchar> &payload,
       return false;
     }
 
-    out.insert(out.end(), payload.begin() + crc1_pos + 2,
-               payload.begin() + crc2_pos);
     if (!fail_is_ok) {
       debug("(wmbus) ff b dll crc final %zu-%zu %04x ok\n", crc1_pos + 2,
             crc2_pos, calc_crc);
     }
   }
 
-  debugPayload("(wmbus) trimming frame B", payload);
+  // Both crcs are verified, move the second block down over the first crc.
+  size_t out = crc1_pos;
+  if (crc2_pos > 0) {
+    size_t len2 = crc2_pos - crc1_pos - 2;
+    memmove(&payload[crc1_pos], &payload[crc1_pos + 2], len2);
+    out += len2;
+  }
+  payload.resize(out);
 
-  out[0] = out.size() - 1;
-  size_t new_len = out[0] + 1;
-  size_t old_size = payload.size();
-  payload = out;
+  payload[0] = out - 1;
+  size_t new_len = payload[0] + 1;
+  size_t old_size = len;
   size_t new_size = payload.size();
 
   debug("(wmbus) trimmed %zu dll crc bytes from frame b and ignored %zu suffix "
@@ -5375,6 +5415,19 @@ bool SendBusContent::parse(const std::string &s) {
   return true;
 }
 
+const AesContext *MeterKeys::confidentialityContext() {
+  if (confidentiality_key.size() != 16)
+    return NULL;
+
+  if (!confidentiality_ctx_valid_ ||
+      memcmp(confidentiality_ctx_key_, confidentiality_key.data(), 16)) {
+    AES_init_ctx(&confidentiality_ctx_, confidentiality_key.data());
+    memcpy(confidentiality_ctx_key_, confidentiality_key.data(), 16);
+    confidentiality_ctx_valid_ = true;
+  }
+  return &confidentiality_ctx_;
+}
+
 const char *toString(FrameType ft) {
   switch (ft) {
   case FrameType::WMBUS:
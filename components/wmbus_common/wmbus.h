@@ -19,6 +19,7 @@
 #define WMBUS_H
 
 #include "address.h"
+#include "aes.h"
 #include "dvparser.h"
 #include "manufacturers.h"
 #include "translatebits.h"
@@ -272,6 +273,15 @@ struct MeterKeys {
 
   bool hasConfidentialityKey() { return confidentiality_key.size() > 0; }
   bool hasAuthenticationKey() { return authentication_key.size() > 0; }
+
+  // Expanded confidentiality_key, NULL unless it is a 16 byte key. The key
+  // is only expanded again when confidentiality_key has changed.
+  const AesContext *confidentialityContext();
+
+private:
+  AesContext confidentiality_ctx_{};
+  uchar confidentiality_ctx_key_[16]{};
+  bool confidentiality_ctx_valid_{};
 };
 
 enum class FrameType { WMBUS, MBUS, HAN };
@@ -311,6 +321,8 @@ struct Explanation {
   std::string info;
   KindOfData kind{};
   Understanding understanding{};
+  // The info is prefixed with the explained bytes in hex when printed.
+  bool hex_prefix{};
 
   Explanation(int p, int l, const std::string &i, KindOfData k, Understanding u)
       : pos(p), len(l), info(i), kind(k), understanding(u) {}
@@ -319,12 +331,11 @@ struct Explanation {
 struct Meter;
 
 struct Telegram {
-private:
-  Telegram(const Telegram &t) = default;
-
-public:
   Telegram() = default;
-  Telegram& operator=(const Telegram &t) = default;
+  // The dv entries are views into frame, a copy would point into the frame
+  // of the original.
+  Telegram(const Telegram &t) = delete;
+  Telegram& operator=(const Telegram &t) = delete;
 
   AboutTelegram about;
 
@@ -454,17 +465,20 @@ public:
 
   bool handled{}; // Set to true, when a meter has accepted the telegram.
 
-  bool parseHeader(std::vector<uchar> &input_frame);
-  bool parse(std::vector<uchar> &input_frame, MeterKeys *mk, bool warn);
+  bool parseHeader(const std::vector<uchar> &input_frame);
+  bool parse(const std::vector<uchar> &input_frame, MeterKeys *mk, bool warn);
 
-  bool parseMBUSHeader(std::vector<uchar> &input_frame);
-  bool parseMBUS(std::vector<uchar> &input_frame, MeterKeys *mk, bool warn);
+  bool parseMBUSHeader(const std::vector<uchar> &input_frame);
+  bool parseMBUS(const std::vector<uchar> &input_frame, MeterKeys *mk,
+                 bool warn);
 
-  bool parseWMBUSHeader(std::vector<uchar> &input_frame);
-  bool parseWMBUS(std::vector<uchar> &input_frame, MeterKeys *mk, bool warn);
+  bool parseWMBUSHeader(const std::vector<uchar> &input_frame);
+  bool parseWMBUS(const std::vector<uchar> &input_frame, MeterKeys *mk,
+                  bool warn);
 
-  bool parseHANHeader(std::vector<uchar> &input_frame);
-  bool parseHAN(std::vector<uchar> &input_frame, MeterKeys *mk, bool warn);
+  bool parseHANHeader(const std::vector<uchar> &input_frame);
+  bool parseHAN(const std::vector<uchar> &input_frame, MeterKeys *mk,
+                bool warn);
 
   void addAddressMfctFirst(const std::vector<uchar>::iterator &pos);
   void addAddressIdFirst(const std::vector<uchar>::iterator &pos);
@@ -477,6 +491,10 @@ public:
   void addExplanationAndIncrementPos(std::vector<uchar>::iterator &pos, int len,
                                      KindOfData k, Understanding u,
                                      const char *fmt, ...);
+  // Explain the value bytes of a dv entry by their hex, which is only
+  // rendered when the explanations are printed.
+  void addValueExplanationAndIncrementPos(std::vector<uchar>::iterator &pos,
+                                          int len);
   void setExplanation(std::vector<uchar>::iterator &pos, int len, KindOfData k,
                       Understanding u, const char *fmt, ...);
   void addMoreExplanation(int pos, const char *fmt, ...);
@@ -486,6 +504,8 @@ public:
   void addSpecialExplanation(int offset, int len, KindOfData k, Understanding u,
                              const char *fmt, ...);
   void explainParse(std::string intro, int from);
+  // Render the hex of the value explanations into their info.
+  void renderValueExplanations();
   std::string analyzeParse(OutputFormat o, int *content_length,
                            int *understood_content_length);
 
@@ -18,14 +18,31 @@
 #include "aes.h"
 #include "util.h"
 #include "wmbus.h"
+#include "wmbus_utils.h"
 
 #include <assert.h>
 #include <memory.h>
 
+// Expand the key into ctx, returns NULL if there is no key.
+static const AesContext *expandKey(std::vector<uchar> &aeskey,
+                                   AesContext *ctx) {
+  if (aeskey.size() == 0)
+    return NULL;
+  AES_init_ctx(ctx, safeButUnsafeVectorPtr(aeskey));
+  return ctx;
+}
+
 bool decrypt_ELL_AES_CTR(Telegram *t, std::vector<uchar> &frame,
                          std::vector<uchar>::iterator &pos,
                          std::vector<uchar> &aeskey) {
-  if (aeskey.size() == 0)
+  AesContext ctx;
+  return decrypt_ELL_AES_CTR(t, frame, pos, expandKey(aeskey, &ctx));
+}
+
+bool decrypt_ELL_AES_CTR(Telegram *t, std::vector<uchar> &frame,
+                         std::vector<uchar>::iterator &pos,
+                         const AesContext *aesctx) {
+  if (aesctx == NULL)
     return true;
 
   std::vector<uchar> encrypted_bytes;
@@ -72,7 +89,8 @@ bool decrypt_ELL_AES_CTR(Telegram *t, std::vector<uchar> &frame,
 
     // Generate the pseudo-random bits from the IV and the key.
     uchar xordata[16];
-    AES_ECB_encrypt(iv, safeButUnsafeVectorPtr(aeskey), xordata, 16);
+    if (!AES_ECB_encrypt(aesctx, iv, xordata))
+      return false;
 
     // Xor the data with the pseudo-random bits to decrypt into tmp.
     uchar tmp[16];
@@ -112,6 +130,16 @@ bool decrypt_TPL_AES_CBC_IV(Telegram *t, std::vector<uchar> &frame,
                             std::vector<uchar> &aeskey,
                             int *num_encrypted_bytes,
                             int *num_not_encrypted_at_end) {
+  AesContext ctx;
+  return decrypt_TPL_AES_CBC_IV(t, frame, pos, expandKey(aeskey, &ctx),
+                                num_encrypted_bytes, num_not_encrypted_at_end);
+}
+
+bool decrypt_TPL_AES_CBC_IV(Telegram *t, std::vector<uchar> &frame,
+                            std::vector<uchar>::iterator &pos,
+                            const AesContext *aesctx,
+                            int *num_encrypted_bytes,
+                            int *num_not_encrypted_at_end) {
   std::vector<uchar> buffer;
   buffer.insert(buffer.end(), pos, frame.end());
 
@@ -144,7 +172,7 @@ bool decrypt_TPL_AES_CBC_IV(Telegram *t, std::vector<uchar> &frame,
         t->tpl_num_encr_blocks, num_bytes_to_decrypt,
         buffer.size() - num_bytes_to_decrypt);
 
-  if (aeskey.size() == 0)
+  if (aesctx == NULL)
     return false;
 
   debugPayload("(TPL) AES CBC IV decrypting", buffer);
@@ -199,8 +227,9 @@ bool decrypt_TPL_AES_CBC_IV(Telegram *t, std::vector<uchar> &frame,
   memcpy(buffer_data.data(), safeButUnsafeVectorPtr(buffer), num_bytes_to_decrypt);
   std::vector<uchar> decrypted_data(num_bytes_to_decrypt);
 
-  AES_CBC_decrypt_buffer(decrypted_data.data(), buffer_data.data(), num_bytes_to_decrypt,
-                         safeButUnsafeVectorPtr(aeskey), iv);
+  if (!AES_CBC_decrypt_buffer(aesctx, decrypted_data.data(),
+                              buffer_data.data(), num_bytes_to_decrypt, iv))
+    return false;
 
   // Remove the encrypted bytes.
   frame.erase(pos, frame.end());
@@ -224,7 +253,18 @@ bool decrypt_TPL_AES_CBC_NO_IV(Telegram *t, std::vector<uchar> &frame,
                                std::vector<uchar> &aeskey,
                                int *num_encrypted_bytes,
                                int *num_not_encrypted_at_end) {
-  if (aeskey.size() == 0)
+  AesContext ctx;
+  return decrypt_TPL_AES_CBC_NO_IV(t, frame, pos, expandKey(aeskey, &ctx),
+                                   num_encrypted_bytes,
+                                   num_not_encrypted_at_end);
+}
+
+bool decrypt_TPL_AES_CBC_NO_IV(Telegram *t, std::vector<uchar> &frame,
+                               std::vector<uchar>::iterator &pos,
+                               const AesContext *aesctx,
+                               int *num_encrypted_bytes,
+                               int *num_not_encrypted_at_end) {
+  if (aesctx == NULL)
     return true;
 
   std::vector<uchar> buffer;
@@ -253,7 +293,7 @@ bool decrypt_TPL_AES_CBC_NO_IV(Telegram *t, std::vector<uchar> &frame,
         t->tpl_num_encr_blocks, num_bytes_to_decrypt,
         buffer.size() - num_bytes_to_decrypt);
 
-  if (aeskey.size() == 0)
+  if (aesctx == NULL)
     return false;
 
   // The content should be a multiple of 16 since we are using AES CBC mode.
@@ -277,8 +317,9 @@ bool decrypt_TPL_AES_CBC_NO_IV(Telegram *t, std::vector<uchar> &frame,
   memcpy(buffer_data.data(), safeButUnsafeVectorPtr(buffer), num_bytes_to_decrypt);
   std::vector<uchar> decrypted_data(num_bytes_to_decrypt);
 
-  AES_CBC_decrypt_buffer(decrypted_data.data(), buffer_data.data(), num_bytes_to_decrypt,
-                         safeButUnsafeVectorPtr(aeskey), iv);
+  if (!AES_CBC_decrypt_buffer(aesctx, decrypted_data.data(),
+                              buffer_data.data(), num_bytes_to_decrypt, iv))
+    return false;
 
   // Remove the encrypted bytes and any potentially not decryptes bytes after.
   frame.erase(pos, frame.end());
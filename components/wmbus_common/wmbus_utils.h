@@ -18,22 +18,38 @@
 #ifndef WMBUS_UTILS_H
 #define WMBUS_UTILS_H
 
+#include "aes.h"
 #include "util.h"
 #include "wmbus.h"
 
+// The aeskey variants expand the key on every call, prefer passing an
+// expanded context (NULL means no key).
 bool decrypt_ELL_AES_CTR(Telegram *t, std::vector<uchar> &frame,
                          std::vector<uchar>::iterator &pos,
                          std::vector<uchar> &aeskey);
+bool decrypt_ELL_AES_CTR(Telegram *t, std::vector<uchar> &frame,
+                         std::vector<uchar>::iterator &pos,
+                         const AesContext *aesctx);
 bool decrypt_TPL_AES_CBC_IV(Telegram *t, std::vector<uchar> &frame,
                             std::vector<uchar>::iterator &pos,
                             std::vector<uchar> &aeskey,
                             int *num_encrypted_bytes,
                             int *num_not_encrypted_at_end);
+bool decrypt_TPL_AES_CBC_IV(Telegram *t, std::vector<uchar> &frame,
+                            std::vector<uchar>::iterator &pos,
+                            const AesContext *aesctx,
+                            int *num_encrypted_bytes,
+                            int *num_not_encrypted_at_end);
 bool decrypt_TPL_AES_CBC_NO_IV(Telegram *t, std::vector<uchar> &frame,
                                std::vector<uchar>::iterator &pos,
                                std::vector<uchar> &aeskey,
                                int *num_encrypted_bytes,
                                int *num_not_encrypted_at_end);
+bool decrypt_TPL_AES_CBC_NO_IV(Telegram *t, std::vector<uchar> &frame,
+                               std::vector<uchar>::iterator &pos,
+                               const AesContext *aesctx,
+                               int *num_encrypted_bytes,
+                               int *num_not_encrypted_at_end);
 
 std::string frameTypeKamstrupC1(int ft);
 
@@ -14,6 +14,8 @@ public:
 
 protected:
   std::string field_name;
+  // Resolved from field_name in setup().
+  FieldHandle field_handle;
 };
 } // namespace wmbus_meter
 } // namespace esphome
\ No newline at end of file
@@ -4,8 +4,12 @@ namespace esphome {
 namespace wmbus_meter {
 static const char *TAG = "wmbus_meter.sensor";
 
+void Sensor::setup() {
+  this->field_handle = this->parent_->resolve_numeric_field(this->field_name);
+}
+
 void Sensor::handle_update() {
-  auto val = this->parent_->get_numeric_field(this->field_name);
+  auto val = this->parent_->get_numeric_field(this->field_handle);
   if (val.has_value())
     this->publish_state(*val);
 }
@@ -7,6 +7,7 @@ namespace esphome {
 namespace wmbus_meter {
 class Sensor : public sensor::Sensor, public BaseSensor {
 public:
+  void setup() override;
   void handle_update();
   void dump_config() override;
 };
@@ -4,8 +4,12 @@ namespace esphome {
 namespace wmbus_meter {
 static const char *TAG = "wmbus_meter.text_sensor";
 
+void TextSensor::setup() {
+  this->field_handle = this->parent_->resolve_string_field(this->field_name);
+}
+
 void TextSensor::handle_update() {
-  auto val = this->parent_->get_string_field(this->field_name);
+  auto val = this->parent_->get_string_field(this->field_handle);
   if (val.has_value())
     this->publish_state(*val);
 }
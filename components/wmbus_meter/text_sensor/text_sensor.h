@@ -7,6 +7,7 @@ namespace esphome {
 namespace wmbus_meter {
 class TextSensor : public text_sensor::TextSensor, public BaseSensor {
 public:
+  void setup() override;
   void handle_update() override;
   void dump_config() override;
 };
@@ -32,8 +32,14 @@ void Meter::setup() {
 }
 void Meter::set_radio(wmbus_radio::Radio *radio) {
   this->radio = radio;
+  // Without a meter there is nothing to route frames to.
+  if (this->meter == nullptr)
+    return;
   radio->add_frame_handler(
-      [this](wmbus_radio::Frame *frame) { return this->handle_frame(frame); });
+      this->meter->addressExpressions(),
+      [this](wmbus_radio::Frame *frame, const Telegram &header) {
+        return this->handle_frame(frame, header);
+      });
 }
 void Meter::dump_config() {
   // Failed components still get dumped, so this has to survive a null meter.
@@ -79,7 +85,7 @@ std::string Meter::get_key() {
                                        : "not-encrypted";
 }
 
-void Meter::handle_frame(wmbus_radio::Frame *frame) {
+void Meter::handle_frame(wmbus_radio::Frame *frame, const Telegram &header) {
   // Runs from the radio callback, not loop(), so mark_failed() does not stop it.
   if (this->meter == nullptr)
     return;
@@ -97,8 +103,8 @@ void Meter::handle_frame(wmbus_radio::Frame *frame) {
   bool id_match = false;
   auto telegram = std::make_unique<Telegram>();
 
-  this->meter->handleTelegram(about, frame->data(), false, &adresses, &id_match,
-                              telegram.get());
+  this->meter->handleTelegram(about, header, frame->data(), false, &adresses,
+                              &id_match, telegram.get());
 
   if (id_match) {
     this->last_telegram = std::move(telegram);
@@ -111,57 +117,127 @@ void Meter::handle_frame(wmbus_radio::Frame *frame) {
   }
 }
 
-std::string Meter::as_json(bool pretty_print) {
-  std::string json;
+const std::string &Meter::as_json(bool pretty_print) {
+  this->json_buffer_.clear();
   if (this->meter == nullptr)
-    return json;
+    return this->json_buffer_;
 
   this->meter->printMeter(this->last_telegram.get(), nullptr, nullptr, '\t',
-                          &json, nullptr, nullptr, nullptr, pretty_print);
-  return json;
+                          &this->json_buffer_, nullptr, nullptr, nullptr,
+                          pretty_print);
+  return this->json_buffer_;
 }
 
 optional<std::string> Meter::get_string_field(std::string field_name) {
-  if (this->meter == nullptr)
-    return {};
-
-  if (field_name == "timestamp")
-    return this->meter->datetimeOfUpdateHumanReadable();
-
-  if (field_name == "timestamp_zulu")
-    return this->meter->datetimeOfUpdateRobot();
+  return this->get_string_field(this->resolve_string_field(field_name));
+}
 
-  auto field_info = this->meter->findFieldInfo(field_name, Quantity::Text);
-  if (field_info)
-    return this->meter->getStringValue(field_info);
+optional<float> Meter::get_numeric_field(std::string field_name) {
+  FieldHandle handle = this->resolve_numeric_field(field_name);
+  return this->get_numeric_field(handle);
+}
 
-  return {};
+FieldHandle Meter::resolve_string_field(const std::string &field_name) {
+  FieldHandle handle;
+  if (this->meter == nullptr)
+    return handle;
+
+  if (field_name == "timestamp") {
+    handle.source = FieldHandle::TIMESTAMP;
+  } else if (field_name == "timestamp_zulu") {
+    handle.source = FieldHandle::TIMESTAMP_ZULU;
+  } else {
+    handle.field_info = this->meter->findFieldInfo(field_name, Quantity::Text);
+    if (handle.field_info != nullptr)
+      handle.source = FieldHandle::FIELD;
+  }
+  return handle;
 }
 
-optional<float> Meter::get_numeric_field(std::string field_name) {
+FieldHandle Meter::resolve_numeric_field(const std::string &field_name) {
+  FieldHandle handle;
   if (this->meter == nullptr)
-    return {};
+    return handle;
 
   // RSSI is not handled by meter but by telegram :/
   if (field_name == "rssi_dbm") {
-    if (this->last_telegram == nullptr)
-      return {};
-    return this->last_telegram->about.rssi_dbm;
+    handle.source = FieldHandle::RSSI;
+    return handle;
   }
 
-  if (field_name == "timestamp")
-    return this->meter->timestampLastUpdate();
+  if (field_name == "timestamp") {
+    handle.source = FieldHandle::TIMESTAMP;
+    return handle;
+  }
 
-  std::string name;
-  Unit unit;
-  extractUnit(field_name, &name, &unit);
+  if (!extractUnit(field_name, &handle.name, &handle.unit))
+    return handle;
+
+  // Values are stored per field name and display unit, so only a field
+  // whose display unit is the requested one can be found.
+  for (FieldInfo &fi : this->meter->fieldInfos()) {
+    if (fi.vname() == handle.name && fi.displayUnit() == handle.unit &&
+        fi.xuantity() != Quantity::Text) {
+      handle.source = FieldHandle::FIELD;
+      handle.field_info = &fi;
+      return handle;
+    }
+  }
 
-  auto value = this->meter->getNumericValue(name, unit);
+  handle.source = FieldHandle::NAMED;
+  return handle;
+}
 
-  if (!std::isnan(value))
-    return value;
+optional<std::string> Meter::get_string_field(const FieldHandle &handle) {
+  switch (handle.source) {
+  case FieldHandle::TIMESTAMP:
+    return this->meter->datetimeOfUpdateHumanReadable();
+  case FieldHandle::TIMESTAMP_ZULU:
+    return this->meter->datetimeOfUpdateRobot();
+  case FieldHandle::FIELD:
+    return this->meter->getStringValue(handle.field_info);
+  default:
+    return {};
+  }
+}
 
-  return {};
+optional<float> Meter::get_numeric_field(FieldHandle &handle) {
+  switch (handle.source) {
+  case FieldHandle::RSSI:
+    if (this->last_telegram == nullptr)
+      return {};
+    return this->last_telegram->about.rssi_dbm;
+  case FieldHandle::TIMESTAMP:
+    return this->meter->timestampLastUpdate();
+  case FieldHandle::FIELD: {
+    double value;
+    Unit stored_unit;
+    if (!this->meter->peekNumericValue(handle.field_info, &value,
+                                       &stored_unit))
+      return {};
+    if (stored_unit != handle.stored_unit) {
+      // Drivers store a field with the same unit every time, so this is
+      // normally only done for the first value.
+      if (!canConvert(stored_unit, handle.unit))
+        return {};
+      handle.stored_unit = stored_unit;
+      handle.offset = convert(0.0, stored_unit, handle.unit);
+      handle.factor = convert(1.0, stored_unit, handle.unit) - handle.offset;
+    }
+    value = value * handle.factor + handle.offset;
+    if (!std::isnan(value))
+      return value;
+    return {};
+  }
+  case FieldHandle::NAMED: {
+    auto value = this->meter->getNumericValue(handle.name, handle.unit);
+    if (!std::isnan(value))
+      return value;
+    return {};
+  }
+  default:
+    return {};
+  }
 }
 
 void Meter::on_telegram(std::function<void()> &&callback) {
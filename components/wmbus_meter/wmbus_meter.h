@@ -9,6 +9,30 @@
 
 namespace esphome {
 namespace wmbus_meter {
+// A sensor field resolved once against the meter driver, so that publishing
+// does not have to split the field name and search the values by name.
+struct FieldHandle {
+  enum Source : uint8_t {
+    NONE,
+    RSSI,
+    TIMESTAMP,
+    TIMESTAMP_ZULU,
+    // A field info of the driver, read directly.
+    FIELD,
+    // A generated field name (e.g. total_at_month_2), looked up by name.
+    NAMED,
+  };
+  Source source{NONE};
+  FieldInfo *field_info{nullptr};
+  std::string name;
+  Unit unit{Unit::Unknown};
+
+  // Cached affine conversion from the unit the value was stored with.
+  Unit stored_unit{Unit::Unknown};
+  double factor{1.0};
+  double offset{0.0};
+};
+
 class Meter : public Component {
 public:
   void set_meter_params(std::string id, std::string driver, std::string key,
@@ -23,10 +47,16 @@ public:
 
   void on_telegram(std::function<void()> &&callback);
 
-  std::string as_json(bool pretty_print = false);
+  // The returned buffer is reused by the next call.
+  const std::string &as_json(bool pretty_print = false);
   optional<std::string> get_string_field(std::string field_name);
   optional<float> get_numeric_field(std::string field_name);
 
+  FieldHandle resolve_string_field(const std::string &field_name);
+  FieldHandle resolve_numeric_field(const std::string &field_name);
+  optional<std::string> get_string_field(const FieldHandle &handle);
+  optional<float> get_numeric_field(FieldHandle &handle);
+
 protected:
   LinkModeSet link_modes_;
   time::RealTimeClock *rtc;
@@ -38,10 +68,11 @@ protected:
 
   std::shared_ptr<::Meter> meter;
   std::unique_ptr<Telegram> last_telegram;
+  std::string json_buffer_;
 
   CallbackManager<void()> on_telegram_callback_manager;
 
-  void handle_frame(wmbus_radio::Frame *frame);
+  void handle_frame(wmbus_radio::Frame *frame, const Telegram &header);
 };
 } // namespace wmbus_meter
 } // namespace esphome
\ No newline at end of file
@@ -32,6 +32,10 @@ CONF_RX_GAIN = "rx_gain"
 CONF_RF_SWITCH = "rf_switch"
 CONF_SYNC_MODE = "sync_mode"
 CONF_HAS_TCXO = "has_tcxo"
+CONF_QUEUE_LENGTH = "queue_length"
+CONF_QUEUE_DROP_POLICY = "queue_drop_policy"
+CONF_LOOP_BUDGET = "loop_budget"
+CONF_PREFILTER = "prefilter"
 
 radio_ns = cg.esphome_ns.namespace("wmbus_radio")
 RadioComponent = radio_ns.class_("Radio", cg.Component)
@@ -40,6 +44,7 @@ RadioTransceiver = radio_ns.class_(
 Frame = radio_ns.class_("Frame")
 FrameOutputFormat = Frame.enum("OutputFormat")
 FramePtr = Frame.operator("ptr")
+QueueDropPolicy = radio_ns.enum("QueueDropPolicy")
 FrameTrigger = radio_ns.class_(
     "FrameTrigger", automation.Trigger.template(FramePtr))
 
@@ -67,6 +72,11 @@ SYNC_MODE_OPTIONS = {
     "ULTRA_LOW_LATENCY": "SYNC_MODE_ULTRA_LOW_LATENCY",
 }
 
+QUEUE_DROP_POLICY_OPTIONS = {
+    "NEWEST": QueueDropPolicy.DROP_NEWEST,
+    "OLDEST": QueueDropPolicy.DROP_OLDEST,
+}
+
 def FILTER_SOURCE_FILES():
     """Return set of transceiver source files to exclude from compilation."""
     exclude = set()
@@ -105,6 +115,18 @@ CONFIG_SCHEMA = (
             ),
             # Use DIO3 to drive an external TCXO (SX1262 only, default: True)
             cv.Optional(CONF_HAS_TCXO, default=True): cv.boolean,
+            # Received packets waiting for the main loop (default: 3)
+            cv.Optional(CONF_QUEUE_LENGTH, default=3): cv.int_range(min=1, max=32),
+            # Packet to drop when the queue is full (default: NEWEST)
+            cv.Optional(CONF_QUEUE_DROP_POLICY, default="NEWEST"): cv.enum(
+                QUEUE_DROP_POLICY_OPTIONS, upper=True
+            ),
+            # Time the main loop may spend on queued packets per iteration
+            cv.Optional(
+                CONF_LOOP_BUDGET, default="10ms"
+            ): cv.positive_time_period_microseconds,
+            # Drop packets from not configured meters before decoding them
+            cv.Optional(CONF_PREFILTER, default=False): cv.boolean,
             cv.Optional(CONF_ON_FRAME): automation.validate_automation(
                 {
                     cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(FrameTrigger),
@@ -159,6 +181,10 @@ async def to_code(config):
     cg.add(cg.LineComment("WMBus Component"))
     var = cg.new_Pvariable(config[CONF_ID])
     cg.add(var.set_radio(radio_var))
+    cg.add(var.set_queue_length(config[CONF_QUEUE_LENGTH]))
+    cg.add(var.set_queue_drop_policy(config[CONF_QUEUE_DROP_POLICY]))
+    cg.add(var.set_loop_budget(config[CONF_LOOP_BUDGET].total_microseconds))
+    cg.add(var.set_prefilter(config[CONF_PREFILTER]))
 
     await cg.register_component(var, config)
 
@@ -175,7 +201,7 @@ async def to_code(config):
 with suppress(ImportError):
     from ..socket_transmitter import (
         SOCKET_SEND_ACTION_SCHEMA,
-        SocketTransmitterSendAction,
+        SocketTransmitterWriteAction,
     )
 
     FRAME_SOCKET_SEND_SCHEMA = SOCKET_SEND_ACTION_SCHEMA.extend(
@@ -194,24 +220,19 @@ with suppress(ImportError):
 
     @automation.register_action(
         "wmbus_radio.send_frame_with_socket",
-        SocketTransmitterSendAction,
+        SocketTransmitterWriteAction,
         FRAME_SOCKET_SEND_SCHEMA,
     )
     async def send_frame_with_socket_to_code(config, action_id, template_arg, args):
-        output_type = {
-            "hex": cg.std_string,
-            "raw": cg.std_vector.template(cg.uint8),
-            "rtlwmbus": cg.std_string,
-        }[config[CONF_FORMAT]]
-
         paren = await cg.get_variable(config[CONF_ID])
-        var = cg.new_Pvariable(
-            action_id, cg.TemplateArguments(output_type, *template_arg), paren
-        )
-        template_ = LambdaExpression(
-            f"return frame.as_{config[CONF_FORMAT]}();", args, ""
+        var = cg.new_Pvariable(action_id, template_arg, paren)
+        # The frame is written straight into the transmitter's buffer
+        writer = LambdaExpression(
+            f"frame->append_{config[CONF_FORMAT]}(buffer);",
+            [(cg.std_vector.template(cg.uint8).operator("ref"), "buffer")] + args,
+            "",
         )
 
-        cg.add(var.set_data(template_))
+        cg.add(var.set_writer(writer))
 
         return var
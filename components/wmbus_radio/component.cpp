@@ -1,5 +1,11 @@
 #include "component.h"
 
+#include <algorithm>
+
+#include "esphome/core/hal.h"
+
+#include "esp_timer.h"
+
 #include "freertos/queue.h"
 #include "freertos/task.h"
 
@@ -19,8 +25,42 @@ namespace esphome {
 namespace wmbus_radio {
 static const char *TAG = "wmbus";
 
+// One filtered packet per interval still takes the full path, so foreign
+// meters keep showing up in the "not handled" log.
+static const uint32_t FOREIGN_SAMPLE_INTERVAL_MS = 60000;
+
+// The id as Address::id prints it, 8 hex digits of the A-field id bytes
+// in reverse order.
+static bool parse_dll_id(const std::string &id, uint32_t *out) {
+  if (id.size() != 8)
+    return false;
+  uint32_t value = 0;
+  for (char c : id) {
+    int digit;
+    if (c >= '0' && c <= '9')
+      digit = c - '0';
+    else if (c >= 'a' && c <= 'f')
+      digit = c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F')
+      digit = c - 'A' + 10;
+    else
+      return false;
+    value = value << 4 | digit;
+  }
+  *out = value;
+  return true;
+}
+
 void Radio::setup() {
-  ASSERT_SETUP(this->packet_queue_ = xQueueCreate(3, sizeof(Packet *)));
+  // Besides the queued ones, one buffer is filled by the receiver task and
+  // one is converted in loop(), so a full queue is the only reason to drop.
+  uint8_t pool_size = this->queue_length_ + 2;
+  this->packet_pool_.resize(pool_size);
+  ASSERT_SETUP(this->packet_queue_ =
+                   xQueueCreate(this->queue_length_, sizeof(uint8_t)));
+  ASSERT_SETUP(this->free_packets_ = xQueueCreate(pool_size, sizeof(uint8_t)));
+  for (uint8_t slot = 0; slot < pool_size; slot++)
+    xQueueSend(this->free_packets_, &slot, 0);
 
   // High priority to avoid FIFO overflow (fills in 5.12ms at 100kbps).
   // Pin to core 1 on dual-core to avoid WiFi ISR preemption on core 0.
@@ -35,18 +75,43 @@ void Radio::setup() {
   ESP_LOGI(TAG, "Receiver task created [%p]", this->receiver_task_handle_);
 
   this->radio->attach_data_interrupt(Radio::wakeup_receiver_task_from_isr,
-                                     &(this->receiver_task_handle_));
+                                     this);
 }
 
 void Radio::loop() {
-  Packet *p;
-  if (xQueueReceive(this->packet_queue_, &p, 0) != pdPASS)
-    return;
+  // Drain bursts in one go, but give the other components their turn once
+  // the budget is used. At least one packet is handled per call.
+  auto start = micros();
+  uint8_t slot;
+  while (xQueueReceive(this->packet_queue_, &slot, 0) == pdPASS) {
+    this->handle_packet(slot);
+    if (micros() - start >= this->loop_budget_us_)
+      break;
+  }
+}
+
+void Radio::handle_packet(uint8_t slot) {
+  auto &packet = this->packet_pool_[slot];
+  auto timestamps = packet.timestamps;
+  auto dequeued_us = micros();
 
   // ESP_LOGI(TAG, "Have RAW data from radio (%zu bytes)",
   //          p->calculate_payload_size());
 
-  auto frame = p->convert_to_frame();
+  this->record_latency(LATENCY_FIFO_READ, timestamps.read - timestamps.irq);
+  this->record_latency(LATENCY_ENQUEUE, timestamps.enqueued - timestamps.read);
+  this->record_latency(LATENCY_QUEUE_WAIT, dequeued_us - timestamps.enqueued);
+
+  if (this->is_foreign_packet(packet)) {
+    this->release_packet(slot);
+    return;
+  }
+
+  auto frame = packet.convert_to_frame();
+  this->release_packet(slot);
+
+  auto converted_us = micros();
+  this->record_latency(LATENCY_CONVERT, converted_us - dequeued_us);
 
   if (!frame)
     return;
@@ -55,20 +120,36 @@ void Radio::loop() {
            frame->data().size(), frame->rssi(), toString(frame->link_mode()),
            frame->format().c_str());
 
-  uint8_t packet_handled = 0;
+  // Parse the header once and route the frame only to the meters that
+  // can match its addresses.
+  Telegram header;
+  header.about.type = FrameType::WMBUS;
+  header.parseHeader(frame->data());
+
   for (auto &handler : this->handlers_)
     handler(&frame.value());
 
-  if (frame->handlers_count())
+  this->dispatch_frame(&frame.value(), header);
+
+  auto handled_us = micros();
+  this->record_latency(LATENCY_HANDLE, handled_us - converted_us);
+
+  if (frame->handlers_count()) {
     ESP_LOGV(TAG, "Telegram handled by %d handlers", frame->handlers_count());
-  else {
+    // Deferred after the meters' on_telegram callbacks, so it runs when
+    // they are done.
+    this->defer([this, handled_us, irq_us = timestamps.irq]() {
+      auto published_us = micros();
+      this->record_latency(LATENCY_PUBLISH, published_us - handled_us);
+      this->record_latency(LATENCY_TOTAL, published_us - irq_us);
+    });
+  } else {
     ESP_LOGW(TAG, "Telegram not handled by any handler");
-    Telegram t;
-    if (t.parseHeader(frame->data()) && t.addresses.empty()) {
+    if (header.addresses.empty()) {
       ESP_LOGW(TAG, "Check if telegram can be parsed on:");
     } else {
       ESP_LOGW(TAG, "Check if telegram with address %s can be parsed on:",
-               t.addresses.back().id.c_str());
+               header.addresses.back().id.c_str());
     }
     ESP_LOGW(TAG,
              (std::string{"https://wmbusmeters.org/analyze/"} + frame->as_hex())
@@ -76,9 +157,91 @@ void Radio::loop() {
   }
 }
 
-void Radio::wakeup_receiver_task_from_isr(TaskHandle_t *arg) {
+bool Radio::is_foreign_packet(Packet &packet) {
+  if (!this->prefilter_ || !this->wildcard_handlers_.empty())
+    return false;
+
+  uint32_t id;
+  if (packet.peek_dll_id(&id) &&
+      std::binary_search(this->prefilter_ids_.begin(),
+                         this->prefilter_ids_.end(), id))
+    return false;
+
+  auto now = millis();
+  if (!this->foreign_sampled_ ||
+      now - this->last_foreign_sample_ms_ >= FOREIGN_SAMPLE_INTERVAL_MS) {
+    this->foreign_sampled_ = true;
+    this->last_foreign_sample_ms_ = now;
+    return false;
+  }
+  this->frames_filtered_++;
+  ESP_LOGV(TAG, "Packet from unknown meter filtered");
+  return true;
+}
+
+void Radio::dump_config() {
+  ESP_LOGCONFIG(TAG, "wM-Bus Radio:");
+  ESP_LOGCONFIG(TAG, "  Queue length: %u", this->queue_length_);
+  ESP_LOGCONFIG(TAG, "  Queue drop policy: %s",
+                this->queue_drop_policy_ == DROP_OLDEST ? "oldest" : "newest");
+  ESP_LOGCONFIG(TAG, "  Loop budget: %uus", (unsigned)this->loop_budget_us_);
+  ESP_LOGCONFIG(TAG, "  Packets enqueued: %u",
+                (unsigned)this->packets_enqueued_);
+  ESP_LOGCONFIG(TAG, "  Packets dropped: %u", (unsigned)this->packets_dropped_);
+  ESP_LOGCONFIG(TAG, "  Queue high water mark: %u",
+                (unsigned)this->queue_high_water_mark_);
+  if (this->prefilter_) {
+    if (this->wildcard_handlers_.empty())
+      ESP_LOGCONFIG(TAG, "  Prefilter: %zu meter ids",
+                    this->prefilter_ids_.size());
+    else
+      ESP_LOGCONFIG(TAG, "  Prefilter: disabled, a meter uses wildcard ids");
+  }
+  log_latency_summary(TAG, this->latency_);
+}
+
+void Radio::record_latency(LatencyStage stage, uint32_t us) {
+  this->latency_[stage].record(us);
+  for (auto *histograms : this->latency_listeners_)
+    (*histograms)[stage].record(us);
+}
+
+void Radio::dispatch_frame(Frame *frame, Telegram &header) {
+  auto &candidates = this->dispatch_candidates_;
+  candidates.clear();
+
+  auto add_candidate = [&candidates](size_t handler) {
+    if (std::find(candidates.begin(), candidates.end(), handler) ==
+        candidates.end())
+      candidates.push_back(handler);
+  };
+
+  for (auto &address : header.addresses) {
+    auto it = this->handlers_by_id_.find(address.id);
+    if (it == this->handlers_by_id_.end())
+      continue;
+    for (auto &entry : it->second)
+      if (entry.mfct == 0xffff || entry.mfct == address.mfct)
+        add_candidate(entry.handler);
+  }
+
+  for (auto handler : this->wildcard_handlers_)
+    add_candidate(handler);
+
+  // Keep the registration order, as when every handler was called.
+  std::sort(candidates.begin(), candidates.end());
+
+  ESP_LOGV(TAG, "Frame dispatched to %zu of %zu meters", candidates.size(),
+           this->addressed_handlers_.size());
+
+  for (auto handler : candidates)
+    this->addressed_handlers_[handler](frame, header);
+}
+
+void Radio::wakeup_receiver_task_from_isr(Radio *arg) {
+  arg->last_irq_us_ = esp_timer_get_time();
   BaseType_t xHigherPriorityTaskWoken;
-  vTaskNotifyGiveFromISR(*arg, &xHigherPriorityTaskWoken);
+  vTaskNotifyGiveFromISR(arg->receiver_task_handle_, &xHigherPriorityTaskWoken);
   portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
@@ -88,37 +251,76 @@ void Radio::receive_frame() {
     return;
   }
 
-  auto packet = std::make_unique<Packet>();
-
-  if (!this->radio->read_in_task(packet->rx_data_ptr(), packet->rx_capacity(), 0)) {
+  uint8_t slot;
+  if (xQueueReceive(this->free_packets_, &slot, 0) != pdPASS) {
+    ESP_LOGW(TAG, "No free packet buffer");
+    this->packets_dropped_++;
     this->radio->restart_rx();
     return;
   }
 
-  if (!packet->calculate_payload_size()) {
-    this->radio->restart_rx();
-    return;
-  }
+  auto &packet = this->packet_pool_[slot];
+  packet.reset();
+  packet.timestamps.irq = this->last_irq_us_;
 
-  if (!this->radio->read_in_task(packet->rx_data_ptr(), packet->rx_capacity(), 3)) {
+  if (!this->read_packet(packet)) {
+    this->release_packet(slot);
     this->radio->restart_rx();
     return;
   }
 
-  packet->set_rssi(this->radio->get_rssi());
+  packet.timestamps.read = micros();
+  packet.set_rssi(this->radio->get_rssi());
 
   // Re-arm sync word detector for next packet
   this->radio->restart_rx();
 
-  auto packet_ptr = packet.get();
+  if (!this->enqueue_packet(slot))
+    this->release_packet(slot);
+}
 
-  if (xQueueSend(this->packet_queue_, &packet_ptr, 0) == pdTRUE) {
-    ESP_LOGV(TAG, "Queue items: %zu",
-             uxQueueMessagesWaiting(this->packet_queue_));
-    ESP_LOGV(TAG, "Queue send success");
-    packet.release();
-  } else
-    ESP_LOGW(TAG, "Queue send failed");
+bool Radio::read_packet(Packet &packet) {
+  if (!this->radio->read_in_task(packet.rx_data_ptr(), packet.rx_capacity(), 0))
+    return false;
+
+  if (!packet.calculate_payload_size())
+    return false;
+
+  return this->radio->read_in_task(packet.rx_data_ptr(), packet.rx_capacity(),
+                                   3);
+}
+
+bool Radio::enqueue_packet(uint8_t slot) {
+  this->packet_pool_[slot].timestamps.enqueued = micros();
+  if (xQueueSend(this->packet_queue_, &slot, 0) != pdTRUE) {
+    uint8_t oldest;
+    if (this->queue_drop_policy_ == DROP_OLDEST &&
+        xQueueReceive(this->packet_queue_, &oldest, 0) == pdPASS) {
+      this->packets_dropped_++;
+      ESP_LOGW(TAG, "Queue full, dropped oldest packet");
+      this->release_packet(oldest);
+    }
+
+    // With DROP_OLDEST the receive above can also fail because loop() has
+    // emptied the queue in the meantime, so there may be room now.
+    if (this->queue_drop_policy_ != DROP_OLDEST ||
+        xQueueSend(this->packet_queue_, &slot, 0) != pdTRUE) {
+      this->packets_dropped_++;
+      ESP_LOGW(TAG, "Queue full, dropped received packet");
+      return false;
+    }
+  }
+
+  this->packets_enqueued_++;
+  uint32_t waiting = uxQueueMessagesWaiting(this->packet_queue_);
+  if (waiting > this->queue_high_water_mark_)
+    this->queue_high_water_mark_ = waiting;
+  ESP_LOGV(TAG, "Queue items: %u", (unsigned)waiting);
+  return true;
+}
+
+void Radio::release_packet(uint8_t slot) {
+  xQueueSend(this->free_packets_, &slot, 0);
 }
 
 void Radio::receiver_task(Radio *arg) {
@@ -130,5 +332,49 @@ void Radio::add_frame_handler(std::function<void(Frame *)> &&callback) {
   this->handlers_.push_back(std::move(callback));
 }
 
+void Radio::add_frame_handler(
+    const std::vector<AddressExpression> &address_expressions,
+    std::function<void(Frame *, const Telegram &)> &&callback) {
+  auto handler = this->addressed_handlers_.size();
+  this->addressed_handlers_.push_back(std::move(callback));
+
+  // Negative and required expressions can only narrow a match down, so only
+  // the positive ones decide where the handler is indexed. The meter still
+  // runs the full expression match on every frame it gets.
+  auto is_positive = [](const AddressExpression &ae) {
+    return !ae.filter_out && !ae.required;
+  };
+
+  bool indexable = false;
+  for (auto &ae : address_expressions) {
+    if (!is_positive(ae))
+      continue;
+    if (ae.has_wildcard) {
+      indexable = false;
+      break;
+    }
+    indexable = true;
+  }
+
+  if (!indexable) {
+    this->wildcard_handlers_.push_back(handler);
+    return;
+  }
+
+  for (auto &ae : address_expressions) {
+    if (!is_positive(ae))
+      continue;
+    this->handlers_by_id_[ae.id].push_back({ae.mfct, handler});
+
+    uint32_t id;
+    if (parse_dll_id(ae.id, &id)) {
+      auto pos = std::lower_bound(this->prefilter_ids_.begin(),
+                                  this->prefilter_ids_.end(), id);
+      if (pos == this->prefilter_ids_.end() || *pos != id)
+        this->prefilter_ids_.insert(pos, id);
+    }
+  }
+}
+
 } // namespace wmbus_radio
 } // namespace esphome
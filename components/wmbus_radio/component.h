@@ -1,6 +1,11 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "freertos/FreeRTOS.h"
 
@@ -10,31 +15,118 @@
 #include "esphome/components/spi/spi.h"
 #include "esphome/components/wmbus_common/wmbus.h"
 
+#include "latency.h"
 #include "packet.h"
 #include "transceiver.h"
 
 namespace esphome {
 namespace wmbus_radio {
 
+// What to do with a received packet when the packet queue is full
+enum QueueDropPolicy : uint8_t {
+  DROP_NEWEST,
+  DROP_OLDEST,
+};
+
 class Radio : public Component {
 public:
   void set_radio(RadioTransceiver *radio) { this->radio = radio; };
+  void set_queue_length(uint8_t length) { this->queue_length_ = length; };
+  void set_queue_drop_policy(QueueDropPolicy policy) {
+    this->queue_drop_policy_ = policy;
+  };
+  void set_loop_budget(uint32_t budget_us) {
+    this->loop_budget_us_ = budget_us;
+  };
+  void set_prefilter(bool prefilter) { this->prefilter_ = prefilter; };
 
   void setup() override;
   void loop() override;
+  void dump_config() override;
   void receive_frame();
 
+  // Queue statistics, updated by the receiver task
+  uint32_t packets_enqueued() const { return this->packets_enqueued_; }
+  uint32_t packets_dropped() const { return this->packets_dropped_; }
+  uint32_t queue_high_water_mark() const {
+    return this->queue_high_water_mark_;
+  }
+  // Packets rejected by the prefilter, counted on the main loop
+  uint32_t frames_filtered() const { return this->frames_filtered_; }
+
+  // Receive path latency since boot, recorded and read on the main loop only
+  const LatencyHistogram &latency(LatencyStage stage) const {
+    return this->latency_[stage];
+  }
+  // Every latency is also recorded into the given histograms, so a listener
+  // can reset its own copy without touching the ones of other listeners.
+  void add_latency_listener(LatencyHistograms *histograms) {
+    this->latency_listeners_.push_back(histograms);
+  }
+
   void add_frame_handler(std::function<void(Frame *)> &&callback);
+  // Handler is called only for frames carrying an address (DLL, ELL or TPL)
+  // that can match one of the given expressions. It also gets the header
+  // parsed once for all handlers.
+  void add_frame_handler(
+      const std::vector<AddressExpression> &address_expressions,
+      std::function<void(Frame *, const Telegram &)> &&callback);
 
 protected:
-  static void wakeup_receiver_task_from_isr(TaskHandle_t *arg);
+  static void wakeup_receiver_task_from_isr(Radio *arg);
   static void receiver_task(Radio *arg);
 
+  void handle_packet(uint8_t slot);
+  bool is_foreign_packet(Packet &packet);
+  bool read_packet(Packet &packet);
+  bool enqueue_packet(uint8_t slot);
+  void release_packet(uint8_t slot);
+
+  void dispatch_frame(Frame *frame, Telegram &header);
+  void record_latency(LatencyStage stage, uint32_t us);
+
   RadioTransceiver *radio{nullptr};
   TaskHandle_t receiver_task_handle_{nullptr};
+  volatile uint32_t last_irq_us_{0};
   QueueHandle_t packet_queue_{nullptr};
+  uint8_t queue_length_{3};
+  QueueDropPolicy queue_drop_policy_{DROP_NEWEST};
+  uint32_t loop_budget_us_{10000};
+
+  std::atomic<uint32_t> packets_enqueued_{0};
+  std::atomic<uint32_t> packets_dropped_{0};
+  std::atomic<uint32_t> queue_high_water_mark_{0};
+
+  LatencyHistograms latency_;
+  std::vector<LatencyHistograms *> latency_listeners_;
+
+  // Packet buffers are allocated once in setup(). Both queues carry pool
+  // indices: packet_queue_ the received ones, free_packets_ the unused ones.
+  std::vector<Packet> packet_pool_;
+  QueueHandle_t free_packets_{nullptr};
 
   std::vector<std::function<void(Frame *)>> handlers_;
+
+  // Address-indexed handlers. Exact ids go to handlers_by_id_, expressions
+  // with wildcards (or without any positive id) go to wildcard_handlers_.
+  struct AddressedHandler {
+    uint16_t mfct; // 0xffff matches any manufacturer
+    size_t handler;
+  };
+  std::vector<std::function<void(Frame *, const Telegram &)>>
+      addressed_handlers_;
+  std::unordered_map<std::string, std::vector<AddressedHandler>>
+      handlers_by_id_;
+  std::vector<size_t> wildcard_handlers_;
+  std::vector<size_t> dispatch_candidates_;
+
+  // Prefilter: sorted DLL ids of the exact meter ids, checked against the
+  // first block before a packet is decoded. Not used with wildcard handlers.
+  bool prefilter_{false};
+  std::vector<uint32_t> prefilter_ids_;
+  uint32_t frames_filtered_{0};
+  bool foreign_sampled_{false};
+  uint32_t last_foreign_sample_ms_{0};
 };
 } // namespace wmbus_radio
 } // namespace esphome
@@ -1,53 +1,85 @@
 #include "decode3of6.h"
 
-#include <map>
-
-#include "esphome/core/helpers.h"
-#include "esphome/core/log.h"
+#include <array>
 
 namespace esphome {
 namespace wmbus_radio {
-static const char *TAG = "3of6";
-std::optional<std::vector<uint8_t>>
-decode3of6(std::vector<uint8_t> &coded_data) {
-
-  static const std::map<uint8_t, uint8_t> lookupTable = {
-      {0b010110, 0x0}, {0b001101, 0x1}, {0b001110, 0x2}, {0b001011, 0x3},
-      {0b011100, 0x4}, {0b011001, 0x5}, {0b011010, 0x6}, {0b010011, 0x7},
-      {0b101100, 0x8}, {0b100101, 0x9}, {0b100110, 0xA}, {0b100011, 0xB},
-      {0b110100, 0xC}, {0b110001, 0xD}, {0b110010, 0xE}, {0b101001, 0xF},
-  };
-
-  // ESP_LOGD(TAG, "Decoding 3of6 data: %s", format_hex(coded_data).c_str());
-
-  std::vector<uint8_t> decodedBytes;
-  auto segments = coded_data.size() * 8 / 6;
-  auto data = coded_data.data();
-
-  for (size_t i = 0; i < segments; i++) {
-    auto bit_idx = i * 6;
-    auto byte_idx = bit_idx / 8;
-    auto bit_offset = bit_idx % 8;
-
-    uint8_t code = (data[byte_idx] << bit_offset);
-    if (bit_offset > 0)
-      code |= (data[byte_idx + 1] >> (8 - bit_offset));
-    code >>= 2;
-
-    auto it = lookupTable.find(code);
-    if (it == lookupTable.end()) {
-      // ESP_LOGW(TAG, "Invalid code: 0x%02X", code);
-      return {};
-    }
-
-    if (i % 2 == 0)
-      decodedBytes.push_back(it->second << 4);
-    else
-      decodedBytes.back() |= it->second;
+namespace {
+constexpr uint8_t INVALID_SYMBOL = 0xFF;
+constexpr uint16_t INVALID_PAIR = 0x100;
+
+// 6-bit code -> nibble
+constexpr std::array<uint8_t, 64> make_symbol_table() {
+  std::array<uint8_t, 64> table{};
+  for (auto &entry : table)
+    entry = INVALID_SYMBOL;
+  table[0b010110] = 0x0;
+  table[0b001101] = 0x1;
+  table[0b001110] = 0x2;
+  table[0b001011] = 0x3;
+  table[0b011100] = 0x4;
+  table[0b011001] = 0x5;
+  table[0b011010] = 0x6;
+  table[0b010011] = 0x7;
+  table[0b101100] = 0x8;
+  table[0b100101] = 0x9;
+  table[0b100110] = 0xA;
+  table[0b100011] = 0xB;
+  table[0b110100] = 0xC;
+  table[0b110001] = 0xD;
+  table[0b110010] = 0xE;
+  table[0b101001] = 0xF;
+  return table;
+}
+
+// 12-bit code (two symbols) -> byte, INVALID_PAIR if either symbol is invalid
+constexpr std::array<uint16_t, 4096> make_pair_table() {
+  constexpr auto symbols = make_symbol_table();
+  std::array<uint16_t, 4096> table{};
+  for (size_t code = 0; code < table.size(); code++) {
+    auto high = symbols[code >> 6];
+    auto low = symbols[code & 0x3F];
+    table[code] = (high == INVALID_SYMBOL || low == INVALID_SYMBOL)
+                      ? INVALID_PAIR
+                      : (high << 4) | low;
   }
+  return table;
+}
+
+constexpr auto PAIR_TABLE = make_pair_table();
+} // namespace
 
-  // ESP_LOGV(TAG, "Successfully decoded %zu bytes", decodedBytes.size());
-  return decodedBytes;
+bool decode3of6(const uint8_t *coded, size_t coded_size, uint8_t *decoded,
+                size_t decoded_size) {
+  if (coded_size < encoded_size(decoded_size))
+    return false;
+
+  // Every 3 coded bytes hold 4 symbols = 2 decoded bytes.
+  size_t out = 0;
+  for (; out + 2 <= decoded_size; out += 2, coded += 3) {
+    uint32_t word = (coded[0] << 16) | (coded[1] << 8) | coded[2];
+    auto first = PAIR_TABLE[word >> 12];
+    auto second = PAIR_TABLE[word & 0xFFF];
+    if ((first | second) & INVALID_PAIR)
+      return false;
+    decoded[out] = first;
+    decoded[out + 1] = second;
+  }
+
+  // Odd length: last byte sits in the next 12 bits.
+  if (out < decoded_size) {
+    auto last = PAIR_TABLE[(coded[0] << 4) | (coded[1] >> 4)];
+    if (last & INVALID_PAIR)
+      return false;
+    decoded[out] = last;
+  }
+
+  return true;
+}
+
+size_t decode3of6(const uint8_t *coded, size_t coded_size, uint8_t *decoded) {
+  auto size = decoded_size(coded_size);
+  return decode3of6(coded, coded_size, decoded, size) ? size : 0;
 }
 
 size_t encoded_size(size_t decoded_size) {
@@ -55,5 +87,10 @@ size_t encoded_size(size_t decoded_size) {
   // bytes of coded data +1 for rounding up
   return (3 * decoded_size + 1) / 2;
 }
+
+size_t decoded_size(size_t encoded_size) {
+  // Whole bytes only, a trailing lone symbol is padding
+  return encoded_size * 8 / 12;
+}
 } // namespace wmbus_radio
-} // namespace esphome
\ No newline at end of file
+} // namespace esphome
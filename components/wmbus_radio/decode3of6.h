@@ -1,13 +1,20 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
-#include <optional>
-#include <vector>
 
 namespace esphome {
 namespace wmbus_radio {
-std::optional<std::vector<uint8_t>>
-decode3of6(std::vector<uint8_t> &coded_data);
+// Decode the first decoded_size bytes of 3-out-of-6 coded data into decoded.
+// coded_size must hold at least encoded_size(decoded_size) bytes. decoded may
+// point into coded (in-place decoding), as output never overtakes input.
+// Returns false on an invalid symbol.
+bool decode3of6(const uint8_t *coded, size_t coded_size, uint8_t *decoded,
+                size_t decoded_size);
+// Decode all complete bytes of coded data. Returns the number of decoded
+// bytes, or 0 on an invalid symbol.
+size_t decode3of6(const uint8_t *coded, size_t coded_size, uint8_t *decoded);
 size_t encoded_size(size_t decoded_size);
+size_t decoded_size(size_t encoded_size);
 } // namespace wmbus_radio
-} // namespace esphome
\ No newline at end of file
+} // namespace esphome
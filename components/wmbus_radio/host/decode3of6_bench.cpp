@@ -0,0 +1,164 @@
+// Compares the table driven 3 of 6 decoder with the std::map based one it
+// replaced, on full length T1 frames. Build and run from
+// components/wmbus_radio:
+//
+//   g++ -std=c++17 -O2 -I. host/decode3of6_bench.cpp decode3of6.cpp
+//   ./a.out
+
+#include "decode3of6.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <optional>
+#include <random>
+#include <vector>
+
+using namespace esphome::wmbus_radio;
+
+namespace legacy {
+// decode3of6 as it was before the lookup tables
+std::optional<std::vector<uint8_t>>
+decode3of6(std::vector<uint8_t> &coded_data) {
+
+  static const std::map<uint8_t, uint8_t> lookupTable = {
+      {0b010110, 0x0}, {0b001101, 0x1}, {0b001110, 0x2}, {0b001011, 0x3},
+      {0b011100, 0x4}, {0b011001, 0x5}, {0b011010, 0x6}, {0b010011, 0x7},
+      {0b101100, 0x8}, {0b100101, 0x9}, {0b100110, 0xA}, {0b100011, 0xB},
+      {0b110100, 0xC}, {0b110001, 0xD}, {0b110010, 0xE}, {0b101001, 0xF},
+  };
+
+  std::vector<uint8_t> decodedBytes;
+  auto segments = coded_data.size() * 8 / 6;
+  auto data = coded_data.data();
+
+  for (size_t i = 0; i < segments; i++) {
+    auto bit_idx = i * 6;
+    auto byte_idx = bit_idx / 8;
+    auto bit_offset = bit_idx % 8;
+
+    uint8_t code = (data[byte_idx] << bit_offset);
+    if (bit_offset > 0)
+      code |= (data[byte_idx + 1] >> (8 - bit_offset));
+    code >>= 2;
+
+    auto it = lookupTable.find(code);
+    if (it == lookupTable.end())
+      return {};
+
+    if (i % 2 == 0)
+      decodedBytes.push_back(it->second << 4);
+    else
+      decodedBytes.back() |= it->second;
+  }
+
+  return decodedBytes;
+}
+} // namespace legacy
+
+static const uint8_t SYMBOLS[16] = {
+    0b010110, 0b001101, 0b001110, 0b001011, 0b011100, 0b011001,
+    0b011010, 0b010011, 0b101100, 0b100101, 0b100110, 0b100011,
+    0b110100, 0b110001, 0b110010, 0b101001,
+};
+
+static std::vector<uint8_t> encode3of6(const std::vector<uint8_t> &data) {
+  std::vector<uint8_t> coded(encoded_size(data.size()));
+  size_t bit = 0;
+  auto put = [&](uint8_t symbol) {
+    for (int i = 5; i >= 0; i--, bit++)
+      if (symbol >> i & 1)
+        coded[bit / 8] |= 0x80 >> (bit % 8);
+  };
+  for (auto byte : data) {
+    put(SYMBOLS[byte >> 4]);
+    put(SYMBOLS[byte & 0xF]);
+  }
+  return coded;
+}
+
+template <typename F> static double ns_per_call(int rounds, F &&fn) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < rounds; i++)
+    fn(i);
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         rounds;
+}
+
+int main() {
+  std::mt19937 rng(3);
+  int failures = 0;
+
+  // Same result for every length up to a full frame, and both reject
+  // a broken symbol
+  for (size_t size = 1; size <= 290; size++) {
+    std::vector<uint8_t> data(size);
+    for (auto &b : data)
+      b = rng();
+    auto coded = encode3of6(data);
+
+    auto expected = legacy::decode3of6(coded);
+    std::vector<uint8_t> decoded(coded.size());
+    auto n = decode3of6(coded.data(), coded.size(), decoded.data());
+    decoded.resize(n);
+    bool same = expected && decoded == *expected &&
+                std::equal(data.begin(), data.end(), decoded.begin());
+    if (!same) {
+      failures++;
+      printf("FAIL decoding %zu bytes\n", size);
+    }
+
+    coded[rng() % coded.size()] ^= 0x24;
+    bool legacy_ok = legacy::decode3of6(coded).has_value();
+    bool table_ok = decode3of6(coded.data(), coded.size(), decoded.data());
+    if (legacy_ok != table_ok) {
+      failures++;
+      printf("FAIL invalid symbol in %zu bytes\n", size);
+    }
+  }
+
+  // Longest T1 frame: L = 255 in frame format A is 290 bytes with crcs
+  std::vector<uint8_t> frame(290);
+  for (auto &b : frame)
+    b = rng();
+  frame[0] = 255;
+  auto coded = encode3of6(frame);
+  std::vector<uint8_t> buffer(coded.size());
+  const int ROUNDS = 20000;
+  volatile uint8_t sink = 0;
+
+  double legacy_full = ns_per_call(ROUNDS, [&](int) {
+    auto decoded = legacy::decode3of6(coded);
+    sink = sink + decoded->back();
+  });
+  double table_full = ns_per_call(ROUNDS, [&](int) {
+    decode3of6(coded.data(), coded.size(), buffer.data(), frame.size());
+    sink = sink + buffer[frame.size() - 1];
+  });
+
+  // Packet::l_field: the old code decoded the whole packet for one byte
+  double legacy_l_field = ns_per_call(ROUNDS, [&](int) {
+    auto decoded = legacy::decode3of6(coded);
+    sink = sink + decoded->front();
+  });
+  double table_l_field = ns_per_call(ROUNDS, [&](int) {
+    uint8_t l_field;
+    decode3of6(coded.data(), coded.size(), &l_field, 1);
+    sink = sink + l_field;
+  });
+
+  printf("%zu byte T1 frame, %zu coded bytes\n", frame.size(), coded.size());
+  printf("  full decode: %.0f ns, std::map %.0f ns\n", table_full,
+         legacy_full);
+  printf("  L-field:     %.0f ns, std::map %.0f ns\n", table_l_field,
+         legacy_l_field);
+
+  if (failures) {
+    printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,88 @@
+#include "latency.h"
+
+#include "esphome/core/log.h"
+
+#include <algorithm>
+
+namespace esphome {
+namespace wmbus_radio {
+const char *latency_stage_name(LatencyStage stage) {
+  switch (stage) {
+  case LATENCY_FIFO_READ:
+    return "fifo_read";
+  case LATENCY_ENQUEUE:
+    return "enqueue";
+  case LATENCY_QUEUE_WAIT:
+    return "queue_wait";
+  case LATENCY_CONVERT:
+    return "convert";
+  case LATENCY_HANDLE:
+    return "handle";
+  case LATENCY_PUBLISH:
+    return "publish";
+  case LATENCY_TOTAL:
+    return "total";
+  default:
+    return "unknown";
+  }
+}
+
+void log_latency_summary(const char *tag, const LatencyHistograms &histograms) {
+  for (uint8_t stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+    auto &histogram = histograms[stage];
+    if (!histogram.count())
+      continue;
+    ESP_LOGD(tag, "Latency %-10s n=%u min=%uus avg=%uus p99=%uus max=%uus",
+             latency_stage_name((LatencyStage)stage),
+             (unsigned)histogram.count(), (unsigned)histogram.min(),
+             (unsigned)histogram.avg(), (unsigned)histogram.percentile(99),
+             (unsigned)histogram.max());
+  }
+}
+
+void LatencyHistogram::record(uint32_t us) {
+  this->buckets_[bucket_of(us)]++;
+  this->count_++;
+  this->sum_ += us;
+  this->min_ = std::min(this->min_, us);
+  this->max_ = std::max(this->max_, us);
+}
+
+void LatencyHistogram::reset() { *this = LatencyHistogram{}; }
+
+uint32_t LatencyHistogram::percentile(uint8_t percent) const {
+  if (!this->count_)
+    return 0;
+
+  uint32_t rank = (uint64_t(this->count_) * percent + 99) / 100;
+  uint32_t seen = 0;
+  for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+    seen += this->buckets_[bucket];
+    if (seen >= rank)
+      return std::min(bucket_upper_bound(bucket), this->max_);
+  }
+  return this->max_;
+}
+
+size_t LatencyHistogram::bucket_of(uint32_t us) {
+  if (us < 8)
+    return us;
+
+  uint8_t exponent = 31 - __builtin_clz(us);
+  if (exponent > MAX_EXPONENT)
+    return BUCKETS - 1;
+
+  // Two bits below the leading one select the sub-bucket
+  return 8 + (exponent - 3) * 4 + ((us >> (exponent - 2)) & 3);
+}
+
+uint32_t LatencyHistogram::bucket_upper_bound(size_t bucket) {
+  if (bucket < 8)
+    return bucket;
+
+  uint8_t exponent = 3 + (bucket - 8) / 4;
+  uint32_t width = 1u << (exponent - 2);
+  return (4 + (bucket - 8) % 4) * width + width - 1;
+}
+} // namespace wmbus_radio
+} // namespace esphome
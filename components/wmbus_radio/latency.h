@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace wmbus_radio {
+// Receive path stages, from the radio interrupt to the published sensors
+enum LatencyStage : uint8_t {
+  LATENCY_FIFO_READ,  // IRQ -> packet read from the radio FIFO
+  LATENCY_ENQUEUE,    // FIFO read -> packet in the queue
+  LATENCY_QUEUE_WAIT, // in the queue -> taken by loop()
+  LATENCY_CONVERT,    // convert_to_frame()
+  LATENCY_HANDLE,     // frame handlers (meters' handleTelegram)
+  LATENCY_PUBLISH,    // deferred on_telegram callbacks and sensor updates
+  LATENCY_TOTAL,      // IRQ -> published
+  LATENCY_STAGE_COUNT,
+};
+
+const char *latency_stage_name(LatencyStage stage);
+
+// Histogram of durations in microseconds. Buckets are exact below 8us, above
+// there are 4 buckets per power of two, so percentiles are within 25%.
+class LatencyHistogram {
+public:
+  void record(uint32_t us);
+  void reset();
+
+  uint32_t count() const { return this->count_; }
+  uint32_t min() const { return this->count_ ? this->min_ : 0; }
+  uint32_t max() const { return this->max_; }
+  uint32_t avg() const { return this->count_ ? this->sum_ / this->count_ : 0; }
+  // Upper bound of the bucket holding the given percentile
+  uint32_t percentile(uint8_t percent) const;
+
+protected:
+  // Up to 2^26us (~67s), longer durations end up in the last bucket
+  static constexpr uint8_t MAX_EXPONENT = 25;
+  static constexpr size_t BUCKETS = 8 + (MAX_EXPONENT - 2) * 4;
+
+  static size_t bucket_of(uint32_t us);
+  static uint32_t bucket_upper_bound(size_t bucket);
+
+  std::array<uint32_t, BUCKETS> buckets_{};
+  uint32_t count_{0};
+  uint32_t min_{UINT32_MAX};
+  uint32_t max_{0};
+  uint64_t sum_{0};
+};
+
+using LatencyHistograms = std::array<LatencyHistogram, LATENCY_STAGE_COUNT>;
+
+void log_latency_summary(const char *tag, const LatencyHistograms &histograms);
+} // namespace wmbus_radio
+} // namespace esphome
@@ -1,5 +1,7 @@
 #include "packet.h"
 
+#include <algorithm>
+#include <cstring>
 #include <ctime>
 
 #include "esphome/components/wmbus_common/meters.h"
@@ -16,7 +18,20 @@
 namespace esphome {
 namespace wmbus_radio {
 static const char *TAG = "packet";
-Packet::Packet() { this->data_.reserve(WMBUS_PREAMBLE_SIZE); }
+Packet::Packet() {
+  this->data_.reserve(MAX_PACKET_SIZE);
+  this->reset();
+}
+
+void Packet::reset() {
+  this->data_.clear();
+  this->rx_size_ = WMBUS_PREAMBLE_SIZE;
+  this->expected_size_ = 0;
+  this->rssi_ = 0;
+  this->link_mode_ = LinkMode::UNKNOWN;
+  this->frame_format_.clear();
+  this->timestamps = {};
+}
 
 // Determine the link mode based on the first byte of the data
 LinkMode Packet::link_mode() {
@@ -43,9 +58,9 @@ uint8_t Packet::l_field() {
       return this->data_[2];
     break;
   case LinkMode::T1: {
-    auto decoded = decode3of6(this->data_);
-    if (decoded && !decoded->empty())
-      return (*decoded)[0];
+    uint8_t l_field;
+    if (decode3of6(this->data_.data(), this->data_.size(), &l_field, 1))
+      return l_field;
     break;
   }
   default:
@@ -85,8 +100,8 @@ size_t Packet::expected_size() {
 
 size_t Packet::rx_capacity() {
   // TODO: Remove side effects?
-  auto cap = this->data_.capacity() - this->data_.size();
-  this->data_.resize(this->data_.capacity());
+  auto cap = this->rx_size_ - this->data_.size();
+  this->data_.resize(this->rx_size_);
   return cap;
 }
 
@@ -96,10 +111,41 @@ uint8_t *Packet::rx_data_ptr() {
 
 bool Packet::calculate_payload_size() {
   auto total_length = this->expected_size();
-  this->data_.reserve(total_length);
+  if (total_length > MAX_PACKET_SIZE) {
+    ESP_LOGW(TAG, "Packet too long: %zu bytes", total_length);
+    return false;
+  }
+  this->rx_size_ = std::max(total_length, this->data_.size());
   return total_length;
 }
 
+bool Packet::peek_dll_id(uint32_t *id) {
+  // L C M M A A A A A A CRC CRC
+  uint8_t block[12];
+  bool has_crc = true;
+  switch (this->link_mode()) {
+  case LinkMode::T1:
+    if (!decode3of6(this->data_.data(), this->data_.size(), block,
+                    sizeof(block)))
+      return false;
+    break;
+  case LinkMode::C1:
+    if (this->data_.size() < WMBUS_MODE_C_SUFIX_LEN + sizeof(block))
+      return false;
+    memcpy(block, this->data_.data() + WMBUS_MODE_C_SUFIX_LEN, sizeof(block));
+    // The first CRC of frame format B covers up to 126 bytes
+    has_crc = this->data_[1] == WMBUS_BLOCK_A_PREAMBLE;
+    break;
+  default:
+    return false;
+  }
+
+  if (has_crc && crc16_EN13757(block, 10) != (block[10] << 8 | block[11]))
+    return false;
+  *id = block[7] << 24 | block[6] << 16 | block[5] << 8 | block[4];
+  return true;
+}
+
 std::optional<Frame> Packet::convert_to_frame() {
   std::optional<Frame> frame = {};
 
@@ -110,9 +156,10 @@ std::optional<Frame> Packet::convert_to_frame() {
     if (this->link_mode() == LinkMode::T1) {
       // TODO: Remove assumption that T1 is always A
       this->frame_format_ = "A";
-      auto decoded_data = decode3of6(this->data_);
-      if (decoded_data)
-        this->data_ = decoded_data.value();
+      auto decoded_size =
+          decode3of6(this->data_.data(), this->data_.size(), this->data_.data());
+      if (decoded_size)
+        this->data_.resize(decoded_size);
     } else if (this->link_mode() == LinkMode::C1) {
       if (this->data_.size() > 1) {
         if (this->data_[1] == WMBUS_BLOCK_A_PREAMBLE)
@@ -145,13 +192,12 @@ std::optional<Frame> Packet::convert_to_frame() {
                 FrameStatus::FullFrame))
     frame.emplace(this);
 
-  delete this;
-
   return frame;
 }
 
+// Data is copied, the packet buffer stays in the pool
 Frame::Frame(Packet *packet)
-    : data_(std::move(packet->data_)), link_mode_(packet->link_mode_),
+    : data_(packet->data_), link_mode_(packet->link_mode_),
       rssi_(packet->rssi_), format_(packet->frame_format_) {}
 
 std::vector<uint8_t> &Frame::data() { return this->data_; }
@@ -159,32 +205,106 @@ LinkMode Frame::link_mode() { return this->link_mode_; }
 int8_t Frame::rssi() { return this->rssi_; }
 std::string Frame::format() { return this->format_; }
 
-std::vector<uint8_t> Frame::as_raw() { return this->data_; }
-std::string Frame::as_hex() { return format_hex(this->data_); }
-std::string Frame::as_rtlwmbus() {
-  const size_t time_repr_size = sizeof("YYYY-MM-DD HH:MM:SS.00Z");
-  char time_buffer[time_repr_size] = "1970-01-01 00:00:00.00Z";
+static const char HEX_DIGITS[] = "0123456789abcdef";
+static const size_t TIMESTAMP_SIZE = sizeof("YYYY-MM-DD HH:MM:SS.00Z") - 1;
+static const size_t MAX_LINK_MODE_NAME_SIZE = sizeof("UnknownLinkMode") - 1;
+
+// Frames are formatted from the main loop only, so the timestamp of the
+// current second is kept without locking and gmtime/strftime run at most
+// once per second.
+static const char *rtlwmbus_timestamp() {
+  static time_t cached_second = -1;
+  static char cached[TIMESTAMP_SIZE + 1] = "1970-01-01 00:00:00.00Z";
   auto t = std::time(NULL);
-  auto *tm_info = std::gmtime(&t);
-  if (tm_info != nullptr) {
-    std::strftime(time_buffer, time_repr_size, "%F %T.00Z", tm_info);
+  if (t != cached_second) {
+    cached_second = t;
+    auto *tm_info = std::gmtime(&t);
+    if (tm_info != nullptr)
+      std::strftime(cached, sizeof(cached), "%F %T.00Z", tm_info);
+  }
+  return cached;
+}
+
+static char *write_chars(char *out, const char *chars, size_t length) {
+  memcpy(out, chars, length);
+  return out + length;
+}
+
+static char *write_int(char *out, int value) {
+  if (value < 0) {
+    *out++ = '-';
+    value = -value;
   }
+  char digits[4];
+  size_t n = 0;
+  do {
+    digits[n++] = '0' + value % 10;
+    value /= 10;
+  } while (value != 0);
+  while (n > 0)
+    *out++ = digits[--n];
+  return out;
+}
 
-  auto output = std::string{};
-  output.reserve(2 + 5 + 24 + 1 + 4 + 5 + 2 * this->data_.size() + 1);
+const std::vector<uint8_t> &Frame::as_raw() { return this->data_; }
 
-  output += linkModeName(this->link_mode_); // size 2
-  output += ";1;1;";                        // size 5
-  output += time_buffer;                    // size 24
-  output += ';';                            // size 1
-  output += std::to_string(this->rssi_);    // size up to 4
-  output += ";;;0x";                        // size 5
-  output += this->as_hex();                 // size 2 * frame.size()
-  output += "\n";                           // size 1
+std::string Frame::as_hex() {
+  std::string output(2 * this->data_.size(), '\0');
+  this->write_hex(&output[0]);
+  return output;
+}
 
+std::string Frame::as_rtlwmbus() {
+  std::string output(this->rtlwmbus_max_size(), '\0');
+  output.resize(this->write_rtlwmbus(&output[0]));
   return output;
 }
 
+size_t Frame::write_hex(char *out) {
+  for (auto byte : this->data_) {
+    *out++ = HEX_DIGITS[byte >> 4];
+    *out++ = HEX_DIGITS[byte & 0x0F];
+  }
+  return 2 * this->data_.size();
+}
+
+size_t Frame::rtlwmbus_max_size() {
+  return MAX_LINK_MODE_NAME_SIZE + 5 + TIMESTAMP_SIZE + 1 + 4 + 5 +
+         2 * this->data_.size() + 1;
+}
+
+size_t Frame::write_rtlwmbus(char *out) {
+  char *p = out;
+  auto link_mode = linkModeName(this->link_mode_);
+  p = write_chars(p, link_mode.data(),
+                  std::min(link_mode.size(), MAX_LINK_MODE_NAME_SIZE));
+  p = write_chars(p, ";1;1;", 5);
+  p = write_chars(p, rtlwmbus_timestamp(), TIMESTAMP_SIZE);
+  *p++ = ';';
+  p = write_int(p, this->rssi_);
+  p = write_chars(p, ";;;0x", 5);
+  p += this->write_hex(p);
+  *p++ = '\n';
+  return p - out;
+}
+
+void Frame::append_raw(std::vector<uint8_t> &buffer) {
+  buffer.insert(buffer.end(), this->data_.begin(), this->data_.end());
+}
+
+void Frame::append_hex(std::vector<uint8_t> &buffer) {
+  size_t offset = buffer.size();
+  buffer.resize(offset + 2 * this->data_.size());
+  this->write_hex((char *)buffer.data() + offset);
+}
+
+void Frame::append_rtlwmbus(std::vector<uint8_t> &buffer) {
+  size_t offset = buffer.size();
+  buffer.resize(offset + this->rtlwmbus_max_size());
+  buffer.resize(offset +
+                this->write_rtlwmbus((char *)buffer.data() + offset));
+}
+
 void Frame::mark_as_handled() { this->handlers_count_++; }
 uint8_t Frame::handlers_count() { return this->handlers_count_; }
 
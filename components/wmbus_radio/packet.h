@@ -11,6 +11,10 @@
 
 namespace esphome {
 namespace wmbus_radio {
+// Longest packet the radio can deliver: T1 (3-of-6 encoded) format A frame
+// with L = 255, i.e. 256 data bytes + 17 block CRCs, times 1.5.
+static constexpr size_t MAX_PACKET_SIZE = (256 + 17 * 2) * 3 / 2;
+
 struct Frame;
 
 struct Packet {
@@ -19,15 +23,29 @@ struct Packet {
 public:
   Packet();
 
+  // Prepare for reuse of the buffer, keeps the allocated capacity
+  void reset();
+
   uint8_t *rx_data_ptr();
   size_t rx_capacity();
   bool calculate_payload_size();
   void set_rssi(int8_t rssi);
 
   std::optional<Frame> convert_to_frame();
+  // Read the DLL id (A-field without version and type, as stored in the
+  // frame) from the first block only. Fails on a bad first block CRC.
+  bool peek_dll_id(uint32_t *id);
+
+  // Receive path timestamps (micros), for latency statistics
+  struct {
+    uint32_t irq;
+    uint32_t read;
+    uint32_t enqueued;
+  } timestamps{};
 
 protected:
   std::vector<uint8_t> data_;
+  size_t rx_size_ = 0;
 
   size_t expected_size();
   size_t expected_size_ = 0;
@@ -50,10 +68,22 @@ public:
   int8_t rssi();
   std::string format();
 
-  std::vector<uint8_t> as_raw();
+  const std::vector<uint8_t> &as_raw();
   std::string as_hex();
   std::string as_rtlwmbus();
 
+  // Append the same representations to a caller owned buffer.
+  void append_raw(std::vector<uint8_t> &buffer);
+  void append_hex(std::vector<uint8_t> &buffer);
+  void append_rtlwmbus(std::vector<uint8_t> &buffer);
+
+  // Write into a buffer of at least 2 * data().size() or
+  // rtlwmbus_max_size() chars, return the number of chars written (not
+  // terminated).
+  size_t write_hex(char *out);
+  size_t rtlwmbus_max_size();
+  size_t write_rtlwmbus(char *out);
+
   void mark_as_handled();
   uint8_t handlers_count();
 
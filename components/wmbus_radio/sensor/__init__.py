@@ -0,0 +1,99 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import sensor
+from esphome.const import (
+    CONF_ID,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+)
+
+from .. import radio_ns, RadioComponent
+
+CONF_RADIO_ID = "radio_id"
+CONF_PACKETS_ENQUEUED = "packets_enqueued"
+CONF_PACKETS_DROPPED = "packets_dropped"
+CONF_QUEUE_HIGH_WATER_MARK = "queue_high_water_mark"
+CONF_FRAMES_FILTERED = "frames_filtered"
+CONF_LATENCY = "latency"
+CONF_STAGE = "stage"
+CONF_STATISTIC = "statistic"
+
+RadioStatistics = radio_ns.class_("RadioStatistics", cg.PollingComponent)
+LatencyStage = radio_ns.enum("LatencyStage")
+LatencyStatistic = radio_ns.enum("LatencyStatistic")
+
+LATENCY_STAGES = {
+    "fifo_read": LatencyStage.LATENCY_FIFO_READ,
+    "enqueue": LatencyStage.LATENCY_ENQUEUE,
+    "queue_wait": LatencyStage.LATENCY_QUEUE_WAIT,
+    "convert": LatencyStage.LATENCY_CONVERT,
+    "handle": LatencyStage.LATENCY_HANDLE,
+    "publish": LatencyStage.LATENCY_PUBLISH,
+    "total": LatencyStage.LATENCY_TOTAL,
+}
+
+LATENCY_STATISTICS = {
+    "min": LatencyStatistic.LATENCY_MIN,
+    "avg": LatencyStatistic.LATENCY_AVG,
+    "p99": LatencyStatistic.LATENCY_P99,
+    "max": LatencyStatistic.LATENCY_MAX,
+}
+
+COUNTER_SCHEMA = sensor.sensor_schema(
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_TOTAL_INCREASING,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(): cv.declare_id(RadioStatistics),
+        cv.GenerateID(CONF_RADIO_ID): cv.use_id(RadioComponent),
+        cv.Optional(CONF_PACKETS_ENQUEUED): COUNTER_SCHEMA,
+        cv.Optional(CONF_PACKETS_DROPPED): COUNTER_SCHEMA,
+        cv.Optional(CONF_FRAMES_FILTERED): COUNTER_SCHEMA,
+        cv.Optional(CONF_QUEUE_HIGH_WATER_MARK): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_LATENCY): cv.ensure_list(
+            sensor.sensor_schema(
+                unit_of_measurement="µs",
+                accuracy_decimals=0,
+                state_class=STATE_CLASS_MEASUREMENT,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ).extend(
+                {
+                    cv.Required(CONF_STAGE): cv.enum(LATENCY_STAGES, lower=True),
+                    cv.Optional(CONF_STATISTIC, default="p99"): cv.enum(
+                        LATENCY_STATISTICS, lower=True
+                    ),
+                }
+            )
+        ),
+    }
+).extend(cv.polling_component_schema("60s"))
+
+
+async def to_code(config):
+    var = cg.new_Pvariable(config[CONF_ID])
+    radio = await cg.get_variable(config[CONF_RADIO_ID])
+    cg.add(var.set_radio(radio))
+    await cg.register_component(var, config)
+
+    for key in (
+        CONF_PACKETS_ENQUEUED,
+        CONF_PACKETS_DROPPED,
+        CONF_FRAMES_FILTERED,
+        CONF_QUEUE_HIGH_WATER_MARK,
+    ):
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            cg.add(getattr(var, f"set_{key}_sensor")(sens))
+
+    for conf in config.get(CONF_LATENCY, []):
+        sens = await sensor.new_sensor(conf)
+        cg.add(var.add_latency_sensor(
+            sens, conf[CONF_STAGE], conf[CONF_STATISTIC]))
@@ -0,0 +1,62 @@
+#include "sensor.h"
+
+namespace esphome {
+namespace wmbus_radio {
+static const char *TAG = "wmbus_radio.sensor";
+
+void RadioStatistics::setup() {
+  this->radio_->add_latency_listener(&this->latency_);
+}
+
+void RadioStatistics::update() {
+  if (this->packets_enqueued_sensor_ != nullptr)
+    this->packets_enqueued_sensor_->publish_state(
+        this->radio_->packets_enqueued());
+  if (this->packets_dropped_sensor_ != nullptr)
+    this->packets_dropped_sensor_->publish_state(
+        this->radio_->packets_dropped());
+  if (this->frames_filtered_sensor_ != nullptr)
+    this->frames_filtered_sensor_->publish_state(
+        this->radio_->frames_filtered());
+  if (this->queue_high_water_mark_sensor_ != nullptr)
+    this->queue_high_water_mark_sensor_->publish_state(
+        this->radio_->queue_high_water_mark());
+
+  for (auto &latency_sensor : this->latency_sensors_) {
+    auto &histogram = this->latency_[latency_sensor.stage];
+    if (!histogram.count())
+      continue;
+    switch (latency_sensor.statistic) {
+    case LATENCY_MIN:
+      latency_sensor.sensor->publish_state(histogram.min());
+      break;
+    case LATENCY_AVG:
+      latency_sensor.sensor->publish_state(histogram.avg());
+      break;
+    case LATENCY_P99:
+      latency_sensor.sensor->publish_state(histogram.percentile(99));
+      break;
+    case LATENCY_MAX:
+      latency_sensor.sensor->publish_state(histogram.max());
+      break;
+    }
+  }
+
+  log_latency_summary(TAG, this->latency_);
+  for (auto &histogram : this->latency_)
+    histogram.reset();
+}
+
+void RadioStatistics::dump_config() {
+  ESP_LOGCONFIG(TAG, "wM-Bus Radio Statistics:");
+  LOG_UPDATE_INTERVAL(this);
+  LOG_SENSOR("  ", "Packets enqueued", this->packets_enqueued_sensor_);
+  LOG_SENSOR("  ", "Packets dropped", this->packets_dropped_sensor_);
+  LOG_SENSOR("  ", "Frames filtered", this->frames_filtered_sensor_);
+  LOG_SENSOR("  ", "Queue high water mark",
+             this->queue_high_water_mark_sensor_);
+  for (auto &latency_sensor : this->latency_sensors_)
+    LOG_SENSOR("  ", "Latency", latency_sensor.sensor);
+}
+} // namespace wmbus_radio
+} // namespace esphome
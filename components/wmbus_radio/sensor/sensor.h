@@ -0,0 +1,61 @@
+#pragma once
+#include "esphome/components/sensor/sensor.h"
+#include "esphome/core/component.h"
+
+#include <vector>
+
+#include "../component.h"
+
+namespace esphome {
+namespace wmbus_radio {
+enum LatencyStatistic : uint8_t {
+  LATENCY_MIN,
+  LATENCY_AVG,
+  LATENCY_P99,
+  LATENCY_MAX,
+};
+
+class RadioStatistics : public PollingComponent {
+public:
+  void set_radio(Radio *radio) { this->radio_ = radio; };
+  void set_packets_enqueued_sensor(sensor::Sensor *sensor) {
+    this->packets_enqueued_sensor_ = sensor;
+  };
+  void set_packets_dropped_sensor(sensor::Sensor *sensor) {
+    this->packets_dropped_sensor_ = sensor;
+  };
+  void set_frames_filtered_sensor(sensor::Sensor *sensor) {
+    this->frames_filtered_sensor_ = sensor;
+  };
+  void set_queue_high_water_mark_sensor(sensor::Sensor *sensor) {
+    this->queue_high_water_mark_sensor_ = sensor;
+  };
+
+  void add_latency_sensor(sensor::Sensor *sensor, LatencyStage stage,
+                          LatencyStatistic statistic) {
+    this->latency_sensors_.push_back({sensor, stage, statistic});
+  };
+
+  void setup() override;
+  // Latency is published for the period since the previous update
+  void update() override;
+  void dump_config() override;
+
+protected:
+  Radio *radio_{nullptr};
+  sensor::Sensor *packets_enqueued_sensor_{nullptr};
+  sensor::Sensor *packets_dropped_sensor_{nullptr};
+  sensor::Sensor *frames_filtered_sensor_{nullptr};
+  sensor::Sensor *queue_high_water_mark_sensor_{nullptr};
+
+  struct LatencySensor {
+    sensor::Sensor *sensor;
+    LatencyStage stage;
+    LatencyStatistic statistic;
+  };
+  std::vector<LatencySensor> latency_sensors_;
+  // Latency since the previous update, fed by the radio and reset here
+  LatencyHistograms latency_;
+};
+} // namespace wmbus_radio
+} // namespace esphome
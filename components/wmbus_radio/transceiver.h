@@ -1,5 +1,6 @@
 #pragma once
 #include "esphome/components/spi/spi.h"
+#include "esphome/components/wmbus_common/startup_profiler.h"
 #include "esphome/core/gpio.h"
 #include "esphome/core/optional.h"
 #include "freertos/FreeRTOS.h"
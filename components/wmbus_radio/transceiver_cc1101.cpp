@@ -10,6 +10,7 @@ static const char *TAG = "CC1101";
 #define F_XTAL 26000000
 
 void CC1101::setup() {
+  StartupPhaseScope phase(std::string("transceiver ") + this->get_name());
   this->common_setup();
 
   ESP_LOGV(TAG, "Setup");
@@ -7,6 +7,7 @@ namespace wmbus_radio {
 static const char *TAG = "SX1262";
 
 void SX1262::setup() {
+  StartupPhaseScope phase(std::string("transceiver ") + this->get_name());
   this->common_setup();
 
   ESP_LOGV(TAG, "Setup");
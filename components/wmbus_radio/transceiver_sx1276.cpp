@@ -11,6 +11,7 @@ namespace wmbus_radio {
 static const char *TAG = "SX1276";
 
 void SX1276::setup() {
+  StartupPhaseScope phase(std::string("transceiver ") + this->get_name());
   this->common_setup();
 
   ESP_LOGV(TAG, "Setup");